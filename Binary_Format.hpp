@@ -0,0 +1,80 @@
+#ifndef BINARY_FORMAT_HPP
+#define BINARY_FORMAT_HPP
+
+/*
+  Layout of the binary output format (filter_tags --output-format=binary),
+  shared by Binary_Sink, which writes it, and read_ftb, which reads it.
+
+  All values are little-endian.  A file is an 8-byte magic number followed
+  by chunks; each chunk is an 8-byte header (kind, count) and a payload
+  whose length is a multiple of 8 bytes, so that every column in a file
+  loaded at an 8-byte aligned address is aligned for its type.
+
+  - ANT_CODES / FULL_IDS chunks: count strings, each a uint32 length and
+    that many bytes, padded at the end of the chunk.  These are appended
+    to the antenna code and tag full ID tables, whose entries are indexed
+    from 0 in the order written.  Every string a hit refers to appears
+    before that hit's chunk.
+
+  - HITS chunk: count rows, stored as one column after another, in the
+    order of the Column enum, each column padded to a multiple of 8 bytes.
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <stddef.h>
+
+namespace Binary_Format {
+
+  static const char MAGIC[8] = {'F', 'T', 'A', 'G', 'B', 'I', 'N', '1'};
+
+  enum Chunk_Kind {
+    ANT_CODES = 1,
+    FULL_IDS  = 2,
+    HITS      = 3
+  };
+
+  struct Chunk_Header {
+    uint32_t kind;
+    uint32_t count;
+  };
+
+  enum Column {
+    TS,          // double:   timestamp
+    ANT,         // uint32:   index into antenna code table
+    TAG,         // uint32:   index into tag full ID table
+    RUN_ID,      // uint64:   run ID
+    POS_IN_RUN,  // uint32:   position of hit in run
+    SIG,         // int16:    signal strength
+    BURST_SLOP,  // double:   burst slop
+    DTALINE,     // uint32:   line in .DTA file
+    LAT,         // float:    latitude
+    LON,         // float:    longitude
+    ANT_FREQ,    // double:   antenna frequency, MHz
+    GAIN,        // int16:    gain
+    NUM_COLUMNS
+  };
+
+  static const size_t COLUMN_SIZE[NUM_COLUMNS] = {8, 4, 4, 8, 4, 2, 8, 4, 4, 4, 8, 2};
+
+  inline size_t padded(size_t n) {
+    return (n + 7) & ~ (size_t) 7;
+  };
+
+  // copy n values of size sz between host and little-endian order;
+  // the conversion is its own inverse
+
+  inline void copy_le(void * dst, const void * src, size_t sz, size_t n) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    const char * s = (const char *) src;
+    char * d = (char *) dst;
+    for (size_t i = 0; i < n; ++i, s += sz, d += sz)
+      for (size_t j = 0; j < sz; ++j)
+        d[j] = s[sz - 1 - j];
+#else
+    memcpy(dst, src, sz * n);
+#endif
+  };
+};
+
+#endif // BINARY_FORMAT_HPP
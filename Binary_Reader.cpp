@@ -0,0 +1,102 @@
+#include "Binary_Reader.hpp"
+
+#include <stdio.h>
+#include <sys/stat.h>
+
+using namespace Binary_Format;
+
+Binary_Reader::Binary_Reader(const string & filename) :
+  ant_codes(),
+  full_ids(),
+  chunks(),
+  rows(0),
+  buf(),
+  size(0)
+{
+  FILE * f = filename.length() > 0 ? fopen(filename.c_str(), "rb") : stdin;
+  if (! f)
+    throw std::runtime_error(string("Couldn't open input file ") + filename);
+
+  struct stat st;
+  if (f != stdin && fstat(fileno(f), & st) == 0 && st.st_size > 0) {
+    // a regular file is loaded with one read
+    buf.resize((st.st_size + 7) / 8);
+    size = fread(buf.data(), 1, st.st_size, f);
+  } else {
+    // otherwise, read until EOF, growing the buffer as needed
+    buf.resize(1 << 17);
+    for (;;) {
+      size_t got = fread((char *) buf.data() + size, 1, buf.size() * 8 - size, f);
+      size += got;
+      if (got == 0)
+        break;
+      if (size == buf.size() * 8)
+        buf.resize(2 * buf.size());
+    }
+  }
+  if (f != stdin)
+    fclose(f);
+  parse();
+};
+
+void
+Binary_Reader::read_strings(const char * & p, const char * end, uint32_t n, std::vector < string > & table) {
+  for (uint32_t i = 0; i < n; ++i) {
+    uint32_t len;
+    if (end - p < (ptrdiff_t) sizeof(len))
+      throw std::runtime_error("Truncated string table in binary input");
+    copy_le(& len, p, sizeof(len), 1);
+    p += sizeof(len);
+    if ((size_t) (end - p) < len)
+      throw std::runtime_error("Truncated string table in binary input");
+    table.push_back(string(p, len));
+    p += len;
+  }
+};
+
+void
+Binary_Reader::parse() {
+  const char * base = (const char *) buf.data();
+  const char * p = base;
+  const char * end = base + size;
+
+  if (size < sizeof(MAGIC) || memcmp(p, MAGIC, sizeof(MAGIC)))
+    throw std::runtime_error("Input is not filter_tags binary output");
+  p += sizeof(MAGIC);
+
+  while (p < end) {
+    if ((size_t) (end - p) < sizeof(Chunk_Header))
+      throw std::runtime_error("Truncated chunk header in binary input");
+    uint32_t hdr[2];
+    copy_le(hdr, p, sizeof(uint32_t), 2);
+    p += sizeof(Chunk_Header);
+    const char * start = p;
+
+    switch (hdr[0]) {
+    case ANT_CODES:
+      read_strings(p, end, hdr[1], ant_codes);
+      break;
+    case FULL_IDS:
+      read_strings(p, end, hdr[1], full_ids);
+      break;
+    case HITS:
+      {
+        Chunk c;
+        c.rows = hdr[1];
+        for (int i = 0; i < NUM_COLUMNS; ++i) {
+          size_t len = padded(c.rows * COLUMN_SIZE[i]);
+          if ((size_t) (end - p) < len)
+            throw std::runtime_error("Truncated hits chunk in binary input");
+          c.col[i] = p;
+          p += len;
+        }
+        chunks.push_back(c);
+        rows += c.rows;
+      }
+      break;
+    default:
+      throw std::runtime_error("Unknown chunk type in binary input");
+    }
+    p = start + padded(p - start);
+  }
+};
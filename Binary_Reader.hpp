@@ -0,0 +1,49 @@
+#ifndef BINARY_READER_HPP
+#define BINARY_READER_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Binary_Format.hpp"
+
+#include <vector>
+
+class Binary_Reader {
+
+  // load a file written by Binary_Sink with a single read, and give
+  // access to its columns in place, without any text parsing.
+
+public:
+
+  struct Chunk {
+    size_t rows;
+    const char * col[Binary_Format::NUM_COLUMNS]; // start of each column
+  };
+
+  std::vector < string > ant_codes;
+  std::vector < string > full_ids;
+  std::vector < Chunk > chunks;
+  size_t rows;   // total over all chunks
+
+  // read the named file, or stdin if filename is empty; throws
+  // if it can't be read or is not in the binary format
+
+  Binary_Reader(const string & filename);
+
+  // value of column c in row i of chunk k, e.g. get < double > (k, Binary_Format::TS, i)
+
+  template < typename T >
+  T get(size_t k, Binary_Format::Column c, size_t i) const {
+    T x;
+    Binary_Format::copy_le(& x, chunks[k].col[c] + i * sizeof(T), sizeof(T), 1);
+    return x;
+  };
+
+protected:
+  std::vector < uint64_t > buf;  // the whole file; uint64_t keeps it 8-byte aligned
+  size_t size;                   // bytes of buf in use
+
+  void parse();
+  void read_strings(const char * & p, const char * end, uint32_t n, std::vector < string > & table);
+};
+
+#endif // BINARY_READER_HPP
@@ -0,0 +1,136 @@
+#include "Binary_Sink.hpp"
+
+using namespace Binary_Format;
+
+Binary_Sink::Binary_Sink(ostream *os) :
+  os(os),
+  ant_codes_written(0),
+  max_ant_code(-1),
+  tag_index(),
+  new_tags(),
+  puts_since_check(0),
+  last_flush(std::chrono::steady_clock::now()),
+  chunk()
+{
+  os->write(MAGIC, sizeof(MAGIC));
+};
+
+Binary_Sink::~Binary_Sink() {
+  flush();
+};
+
+void
+Binary_Sink::put(const string &prefix, const Hit &h, Known_Tag *t, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+  auto ti = tag_index.find(t);
+  if (ti == tag_index.end()) {
+    ti = tag_index.insert(std::make_pair(t, (uint32_t) tag_index.size())).first;
+    new_tags.push_back(t);
+  }
+  if (h.ant_code > max_ant_code)
+    max_ant_code = h.ant_code;
+
+  ts.push_back(h.ts);
+  ant.push_back(h.ant_code);
+  tag.push_back(ti->second);
+  this->run_id.push_back(run_id);
+  this->pos_in_run.push_back(pos_in_run);
+  sig.push_back(h.sig);
+  this->burst_slop.push_back(burst_slop);
+  dtaline.push_back(h.dtaline);
+  lat.push_back(h.lat);
+  lon.push_back(h.lon);
+  ant_freq.push_back(h.ant_freq);
+  gain.push_back(h.gain);
+
+  if (ts.size() >= ROWS_PER_CHUNK) {
+    flush();
+  } else if (++puts_since_check == CLOCK_CHECK_EVERY) {
+    puts_since_check = 0;
+    if (std::chrono::duration < double > (std::chrono::steady_clock::now() - last_flush).count() >= MAX_FLUSH_DELAY)
+      flush();
+  }
+};
+
+void
+Binary_Sink::write_chunk(uint32_t kind, uint32_t count) {
+  // write a chunk whose payload has been assembled in chunk
+
+  chunk.resize(padded(chunk.size()), 0);
+  uint32_t hdr[2] = {kind, count};
+  char buf[sizeof(Chunk_Header)];
+  copy_le(buf, hdr, sizeof(uint32_t), 2);
+  os->write(buf, sizeof(buf));
+  os->write(chunk.data(), chunk.size());
+  chunk.clear();
+};
+
+void
+Binary_Sink::add_string(const string &s) {
+  uint32_t len = s.size();
+  size_t n = chunk.size();
+  chunk.resize(n + sizeof(len) + len);
+  copy_le(& chunk[n], & len, sizeof(len), 1);
+  memcpy(& chunk[n + sizeof(len)], s.data(), len);
+};
+
+template < typename T >
+void
+Binary_Sink::add_column(const std::vector < T > & col) {
+  size_t n = chunk.size();
+  chunk.resize(n + padded(col.size() * sizeof(T)), 0);
+  copy_le(& chunk[n], col.data(), sizeof(T), col.size());
+};
+
+void
+Binary_Sink::write_rows() {
+  // write any strings the pending rows need, then the rows themselves
+
+  if (max_ant_code >= ant_codes_written) {
+    for (int i = ant_codes_written; i <= max_ant_code; ++i)
+      add_string(codes->ant_codes[i]);
+    write_chunk(ANT_CODES, max_ant_code + 1 - ant_codes_written);
+    ant_codes_written = max_ant_code + 1;
+  }
+  if (new_tags.size() > 0) {
+    for (auto it = new_tags.begin(); it != new_tags.end(); ++it)
+      add_string((*it)->fullID);
+    write_chunk(FULL_IDS, new_tags.size());
+    new_tags.clear();
+  }
+
+  add_column(ts);
+  add_column(ant);
+  add_column(tag);
+  add_column(run_id);
+  add_column(pos_in_run);
+  add_column(sig);
+  add_column(burst_slop);
+  add_column(dtaline);
+  add_column(lat);
+  add_column(lon);
+  add_column(ant_freq);
+  add_column(gain);
+  write_chunk(HITS, ts.size());
+
+  ts.clear();
+  ant.clear();
+  tag.clear();
+  run_id.clear();
+  pos_in_run.clear();
+  sig.clear();
+  burst_slop.clear();
+  dtaline.clear();
+  lat.clear();
+  lon.clear();
+  ant_freq.clear();
+  gain.clear();
+};
+
+void
+Binary_Sink::flush() {
+  if (ts.size() > 0)
+    write_rows();
+  os->flush();
+  puts_since_check = 0;
+  last_flush = std::chrono::steady_clock::now();
+};
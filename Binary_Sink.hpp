@@ -0,0 +1,73 @@
+#ifndef BINARY_SINK_HPP
+#define BINARY_SINK_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Output_Sink.hpp"
+#include "Binary_Format.hpp"
+
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+class Binary_Sink : public Output_Sink {
+
+  // write hits to an ostream in the binary columnar format described
+  // in Binary_Format.hpp.  Rows are collected column by column and
+  // written as one HITS chunk once there are ROWS_PER_CHUNK of them,
+  // or once MAX_FLUSH_DELAY seconds have passed since the last write.
+  // The prefix passed to put() is not recorded.
+
+protected:
+  static const size_t ROWS_PER_CHUNK = 1 << 16;
+  static const unsigned CLOCK_CHECK_EVERY = 64; // puts between looks at the clock
+  static constexpr double MAX_FLUSH_DELAY = 1.0;
+
+  ostream * os;
+
+  // the columns of rows not yet written
+
+  std::vector < double > ts;
+  std::vector < uint32_t > ant;
+  std::vector < uint32_t > tag;
+  std::vector < uint64_t > run_id;
+  std::vector < uint32_t > pos_in_run;
+  std::vector < int16_t > sig;
+  std::vector < double > burst_slop;
+  std::vector < uint32_t > dtaline;
+  std::vector < float > lat;
+  std::vector < float > lon;
+  std::vector < double > ant_freq;
+  std::vector < int16_t > gain;
+
+  // string tables: antenna codes are indexed as in the sink's Hit_Codes;
+  // tags are numbered in the order they are first output
+
+  int ant_codes_written;   // ant_codes with index below this have been written
+  int max_ant_code;        // largest antenna code among rows not yet written
+  std::unordered_map < Known_Tag *, uint32_t > tag_index;
+  std::vector < Known_Tag * > new_tags; // tags numbered but not yet written
+
+  unsigned puts_since_check;
+  std::chrono::steady_clock::time_point last_flush;
+
+  std::vector < char > chunk; // scratch for assembling a chunk
+
+  void write_chunk(uint32_t kind, uint32_t count);
+  void add_string(const string &s);
+  template < typename T >
+  void add_column(const std::vector < T > & col);
+  void write_rows();
+
+public:
+
+  Binary_Sink(ostream *os);
+
+  ~Binary_Sink();
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop);
+
+  void flush();
+};
+
+#endif // BINARY_SINK_HPP
@@ -0,0 +1,224 @@
+#include "CSV_Hit_Source.hpp"
+
+#include <string.h>
+#include <stdlib.h>
+#include <float.h>
+#include <stdint.h>
+
+CSV_Hit_Source::CSV_Hit_Source(Line_Reader * lines) :
+  lines(lines),
+  line_no(0),
+  ant_cache(),
+  ant_label(),
+  no_codeset_id(-1)
+{
+};
+
+// parse an optionally negative decimal integer of at most 9 digits
+// ending at a comma, leaving p at the comma
+
+static inline bool
+parse_int(const char * & p, const char * e, long & x) {
+  bool neg = false;
+  if (p < e && *p == '-') {
+    neg = true;
+    ++p;
+  }
+  const char * start = p;
+  long v = 0;
+  while (p < e && *p >= '0' && *p <= '9' && p - start <= 9)
+    v = v * 10 + (*p++ - '0');
+  if (p == start || p - start > 9)
+    return false;
+  x = neg ? -v : v;
+  return true;
+};
+
+// parse a number like -123.4567, giving exactly the double strtod
+// would: when the digits form an integer m < 2^53 and there are at
+// most 22 of them after the point, m and 10^k are exact doubles and
+// a single division rounds correctly.  Anything else is handed to
+// strtod.
+
+static const double powers_of_ten[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static inline bool
+parse_double(const char * & p, const char * e, double & x) {
+  const char * start = p;
+  bool neg = false;
+  if (p < e && *p == '-') {
+    neg = true;
+    ++p;
+  }
+  uint64_t m = 0;
+  int digits = 0, frac = 0;
+  while (p < e && *p >= '0' && *p <= '9' && digits < 19) {
+    m = m * 10 + (*p++ - '0');
+    ++digits;
+  }
+  if (p < e && *p == '.') {
+    ++p;
+    while (p < e && *p >= '0' && *p <= '9' && digits < 19) {
+      m = m * 10 + (*p++ - '0');
+      ++digits;
+      ++frac;
+    }
+  }
+#if FLT_EVAL_METHOD == 0
+  if (digits > 0 && (p == e || *p == ',') && m <= (1ULL << 53) && frac <= 22) {
+    x = (double) m / powers_of_ten[frac];
+    if (neg)
+      x = -x;
+    return true;
+  }
+#endif
+  // the slow way, on a terminated copy of the field
+  const char * comma = (const char *) memchr(start, ',', e - start);
+  if (! comma)
+    return false;
+  char tok[64];
+  size_t n = comma - start;
+  if (n == 0 || n >= sizeof(tok))
+    return false;
+  memcpy(tok, start, n);
+  tok[n] = 0;
+  char * tail;
+  x = strtod(tok, & tail);
+  if (tail != tok + n)
+    return false;
+  p = comma;
+  return true;
+};
+
+static inline bool
+expect(const char * & p, const char * e, char c) {
+  if (p < e && *p == c) {
+    ++p;
+    return true;
+  }
+  return false;
+};
+
+bool
+CSV_Hit_Source::parse_fast(const char * p, const char * e, Hit &h) {
+  double ts, lat, lon, freq;
+  long lid, sig, dtaline, gain;
+
+  if (! (parse_double(p, e, ts) && expect(p, e, ',')
+         && parse_int(p, e, lid) && expect(p, e, ',')
+         && expect(p, e, '"')))
+    return false;
+  const char * ant = p;
+  const char * q = (const char *) memchr(p, '"', e - p);
+  if (! q || q == ant)
+    return false;
+  p = q + 1;
+  if (! (expect(p, e, ',')
+         && parse_int(p, e, sig) && sig >= -32768 && sig <= 32767 && expect(p, e, ',')
+         && parse_double(p, e, lat) && expect(p, e, ',')
+         && parse_double(p, e, lon) && expect(p, e, ',')
+         && parse_int(p, e, dtaline) && dtaline >= 0 && expect(p, e, ',')
+         && parse_double(p, e, freq) && expect(p, e, ',')))
+    return false;
+
+  // gain is the last field sscanf converts; what follows it only matters
+  // if it looks like a quoted codeset without a separating comma, in which
+  // case sscanf converts a 10th field and the line counts as malformed
+
+  if (! parse_int(p, e, gain) || gain < -32768 || gain > 32767)
+    return false;
+  if (p < e && *p == '"')
+    return false;
+
+  if (no_codeset_id < 0)
+    no_codeset_id = codes->codeset_ids.add(std::string());
+  h = Hit::make(codes, ts, lid, get_ant_code(ant, q - ant), sig, lat, lon, dtaline, freq, gain, no_codeset_id);
+  return true;
+};
+
+int
+CSV_Hit_Source::get_ant_code(const char * ant, size_t len) {
+  for (auto ic = ant_cache.begin(); ic != ant_cache.end(); ++ic) {
+    if (ic->first.compare(0, string::npos, ant, len) == 0) {
+      // move it to the front, so a run of hits on one antenna finds it first
+      if (ic != ant_cache.begin())
+        std::swap(*ic, ant_cache.front());
+      return ant_cache.front().second;
+    }
+  }
+  ant_label.assign(ant, len);
+  int code = codes->ant_codes.add(ant_label);
+  if (ant_cache.size() < MAX_CACHED_ANTS) {
+    ant_cache.push_back(std::make_pair(ant_label, code));
+    std::swap(ant_cache.back(), ant_cache.front());
+  }
+  return code;
+};
+
+bool
+CSV_Hit_Source::parse_sscanf(const char * p, size_t len, Hit &h) {
+
+  // fields in a line
+  double ts;
+  int lid;
+  char ant_label[MAX_LINE_SIZE + 1];
+  int ant_code;
+  unsigned int dtaline; // line number in original .DTA source file
+  short sig;
+  double lat;
+  double lon;
+  double freq;
+  short gain;
+
+  char codeset[MAX_LINE_SIZE + 1] = "";
+  int codeset_id;
+
+  char buf[MAX_LINE_SIZE + 1];
+  memcpy(buf, p, len);
+  buf[len] = 0;
+
+  if (9 != sscanf(buf, "%lf,%d,\"%[^\"]\",%hd,%lf,%lf,%u,%lf,%hd\"%[^\"]\"", &ts, &lid, ant_label, &sig, &lat, &lon, &dtaline, &freq, &gain, codeset)) {
+    std::cerr << "Warning: malformed line in input\n  at line " << line_no << ":\n" << (string("") + buf) << std::endl;
+    return false;
+  }
+  ant_code = codes->ant_codes.add(std::string(ant_label));
+  codeset_id = codes->codeset_ids.add(std::string(codeset));
+
+  h = Hit::make(codes, ts, lid, ant_code, sig, lat, lon, dtaline, freq, gain, codeset_id);
+  return true;
+};
+
+bool
+CSV_Hit_Source::next(Hit &h) {
+  const char * line;
+  size_t len;
+
+  while (lines->next_line(line, len)) {
+
+    // as when lines were read with istream::getline into a buffer of
+    // MAX_LINE_SIZE characters, the leading part of an overly long
+    // line is silently dropped, and empty lines are not counted
+
+    while (len > MAX_LINE_SIZE - 1) {
+      line += MAX_LINE_SIZE - 1;
+      len -= MAX_LINE_SIZE - 1;
+    }
+
+    if (len == 0 || ! line[0])
+      continue;
+
+    ++line_no;
+
+    if (parse_fast(line, line + len, h) || parse_sscanf(line, len, h))
+      return true;
+  }
+  return false;
+};
+
+bool
+CSV_Hit_Source::at_end() {
+  return lines->at_end();
+};
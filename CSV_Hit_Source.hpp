@@ -0,0 +1,56 @@
+#ifndef CSV_HIT_SOURCE_HPP
+#define CSV_HIT_SOURCE_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit_Source.hpp"
+#include "Line_Reader.hpp"
+
+#include <vector>
+
+class CSV_Hit_Source : public Hit_Source {
+
+  // hits from a .CSV file generated by the readDTA() R function.
+  // Lines are like this:
+  //   1374672755.3166,118,"1",45,999,999,1345,166.3,90,"Lotek3"
+  //
+  // Lines in the usual form are parsed in a single pass, with numbers
+  // converted exactly as sscanf would convert them; anything unusual
+  // falls back to sscanf itself, so which lines are accepted, and
+  // what is reported about malformed ones, is unchanged.
+
+protected:
+  Line_Reader * lines;
+
+  // count lines of input seen
+  unsigned long long line_no;
+
+  // antenna labels of lines parsed in a single pass, and their codes,
+  // most recently seen first, and the ID of the empty codeset (-1
+  // until known).  A receiver has few antennas, so these save looking
+  // labels up, which hashes and takes a lock, even when hits from
+  // several antennas are interleaved; past MAX_CACHED_ANTS labels,
+  // the rest are looked up each time.
+
+  static const size_t MAX_CACHED_ANTS = 16;
+
+  std::vector < std::pair < std::string, int > > ant_cache;
+  std::string ant_label;  // for looking up labels not cached
+  int no_codeset_id;
+
+  int get_ant_code(const char * ant, size_t len);
+
+  bool parse_fast(const char * p, const char * e, Hit &h);
+
+  bool parse_sscanf(const char * p, size_t len, Hit &h);
+
+public:
+
+  CSV_Hit_Source(Line_Reader * lines);
+
+  bool next(Hit &h);
+
+  bool at_end();
+};
+
+#endif // CSV_HIT_SOURCE_HPP
@@ -0,0 +1,63 @@
+#include "Cand_List.hpp"
+
+Cand_Slab::Cand_Slab() :
+  blocks(),
+  free_slots(0),
+  used_in_block(CANDS_PER_BLOCK),
+  num_live(0)
+{
+};
+
+void *
+Cand_Slab::allocate() {
+  ++num_live;
+  Slot * s;
+  if (free_slots) {
+    s = reinterpret_cast < Slot * > (free_slots);
+    free_slots = free_slots->next;
+  } else {
+    if (used_in_block == CANDS_PER_BLOCK) {
+      blocks.push_back(std::unique_ptr < Slot [] > (new Slot[CANDS_PER_BLOCK]));
+      used_in_block = 0;
+    }
+    s = & blocks.back()[used_in_block++];
+  }
+  s->live = true;
+  return & s->storage;
+};
+
+void
+Cand_Slab::release(Run_Candidate * c) {
+  c->~Run_Candidate();
+  --num_live;
+  reinterpret_cast < Slot * > (c)->live = false;
+  Free_Slot * s = reinterpret_cast < Free_Slot * > (c);
+  s->next = free_slots;
+  free_slots = s;
+};
+
+Cand_List::Cand_List(Cand_Slab * slab) :
+  head(),
+  slab(slab)
+{
+  head.next = head.prev = & head;
+};
+
+Cand_List::Cand_List(Cand_List && l) noexcept :
+  head(),
+  slab(l.slab)
+{
+  if (l.empty()) {
+    head.next = head.prev = & head;
+  } else {
+    head.next = l.head.next;
+    head.prev = l.head.prev;
+    head.next->prev = head.prev->next = & head;
+    l.head.next = l.head.prev = & l.head;
+  }
+};
+
+Cand_List::~Cand_List() {
+  while (! empty())
+    erase(begin());
+};
@@ -0,0 +1,171 @@
+#ifndef CAND_LIST_HPP
+#define CAND_LIST_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Run_Candidate.hpp"
+
+#include <vector>
+#include <memory>
+#include <type_traits>
+
+class Cand_Slab {
+
+  // storage for the Run_Candidates of one Run_Finder, allocated in
+  // blocks and recycled through a free list, so that creating and
+  // destroying candidates doesn't touch the heap once the slab has
+  // grown to the working set.  Not thread-safe; each Run_Finder has
+  // its own.
+
+protected:
+  static const size_t CANDS_PER_BLOCK = 256;
+
+  struct Slot {
+    std::aligned_storage < sizeof(Run_Candidate), alignof(Run_Candidate) > :: type storage; // first, so a slot's address is its candidate's
+    bool live;
+  };
+
+  struct Free_Slot {
+    Free_Slot * next;
+  };
+
+  std::vector < std::unique_ptr < Slot [] > > blocks;
+  Free_Slot * free_slots; // recycled slots
+  size_t used_in_block;   // slots handed out from the last block
+  size_t num_live;        // candidates made and not yet released
+
+  void * allocate();
+
+public:
+
+  Cand_Slab();
+
+  Cand_Slab(const Cand_Slab &) = delete;
+
+  Cand_Slab & operator= (const Cand_Slab &) = delete;
+
+  template < typename... Args >
+  Run_Candidate * make(Args&&... args) {
+    return new (allocate()) Run_Candidate(std::forward < Args > (args)...);
+  };
+
+  void release(Run_Candidate * c);
+
+  // is c, which must have been made by this slab at some time, still
+  // there, rather than released?  Its slot may since have been reused
+  // for another candidate.
+
+  bool is_live(const Run_Candidate * c) const {return reinterpret_cast < const Slot * > (c)->live;};
+
+  // the number of candidates there are now
+
+  size_t size() const {return num_live;};
+
+  // the most candidates there have been at once
+
+  size_t peak() const {return blocks.size() == 0 ? 0 : (blocks.size() - 1) * CANDS_PER_BLOCK + used_in_block;};
+};
+
+class Cand_List {
+
+  // a doubly-linked list of Run_Candidates, linked through their
+  // Cand_Link base and stored in a Cand_Slab.  It has the parts of the
+  // std::list interface that Run_Finder uses; splicing a candidate
+  // from one list to another only relinks it.
+
+protected:
+  Cand_Link head;  // sentinel; head.next is the first candidate, head.prev the last
+  Cand_Slab * slab;
+
+  static void unlink(Cand_Link * c) {
+    c->prev->next = c->next;
+    c->next->prev = c->prev;
+  };
+
+  void link_before(Cand_Link * pos, Cand_Link * c) {
+    c->prev = pos->prev;
+    c->next = pos;
+    pos->prev->next = c;
+    pos->prev = c;
+  };
+
+public:
+
+  class iterator {
+    friend class Cand_List;
+    Cand_Link * p;
+  public:
+    iterator(Cand_Link * p = 0) : p(p) {};
+    Run_Candidate & operator* () const {return * static_cast < Run_Candidate * > (p);};
+    Run_Candidate * operator-> () const {return static_cast < Run_Candidate * > (p);};
+    iterator & operator++ () {p = p->next; return *this;};
+    bool operator== (const iterator & i) const {return p == i.p;};
+    bool operator!= (const iterator & i) const {return p != i.p;};
+  };
+
+  Cand_List(Cand_Slab * slab);
+
+  Cand_List(Cand_List && l) noexcept;
+
+  Cand_List(const Cand_List &) = delete;
+
+  Cand_List & operator= (const Cand_List &) = delete;
+
+  ~Cand_List();
+
+  iterator begin() {return iterator(head.next);};
+
+  iterator end() {return iterator(& head);};
+
+  bool empty() const {return head.next == & head;};
+
+  Run_Candidate & back() {return * static_cast < Run_Candidate * > (head.prev);};
+
+  void push_back(const Run_Candidate & c) {
+    link_before(& head, slab->make(c));
+  };
+
+  template < typename... Args >
+  void emplace_back(Args&&... args) {
+    link_before(& head, slab->make(std::forward < Args > (args)...));
+  };
+
+  // destroy the candidate at i; returns the following position
+
+  iterator erase(iterator i) {
+    Cand_Link * n = i.p->next;
+    unlink(i.p);
+    slab->release(& *i);
+    return iterator(n);
+  };
+
+  // destroy candidate c, which can be on any list sharing this list's slab
+
+  void remove(Run_Candidate * c) {
+    unlink(c);
+    slab->release(c);
+  };
+
+  // move the candidate at i from list l to just before pos in this list
+
+  void splice(iterator pos, Cand_List & l, iterator i) {
+    unlink(i.p);
+    link_before(pos.p, i.p);
+  };
+
+  // move all candidates from list l to just before pos in this list
+
+  void splice(iterator pos, Cand_List & l) {
+    if (& l == this || l.empty())
+      return;
+    Cand_Link * first = l.head.next;
+    Cand_Link * last = l.head.prev;
+    l.head.next = l.head.prev = & l.head;
+    first->prev = pos.p->prev;
+    last->next = pos.p;
+    pos.p->prev->next = first;
+    pos.p->prev = last;
+  };
+};
+
+#endif // CAND_LIST_HPP
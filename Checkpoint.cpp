@@ -0,0 +1,272 @@
+#include "Checkpoint.hpp"
+
+#include <stdio.h>
+#include <string.h>
+
+// file layout: MAGIC, then the size of each type stored (so that a
+// file from a machine or build with different sizes is rejected
+// rather than misread), then the fields in the order written below.
+// Strings and vectors are preceded by a uint64 count.
+
+static const char MAGIC[8] = {'F', 'T', 'A', 'G', 'C', 'K', 'P', '1'};
+
+static const unsigned char TYPE_SIZES[] = {
+  sizeof(unsigned int), sizeof(unsigned long long), sizeof(Hit::Seq_No),
+  sizeof(Timestamp), sizeof(Gap), sizeof(Lotek_Tag_ID), sizeof(Nominal_Frequency_kHz),
+  sizeof(DFA_Node::Index), sizeof(int), sizeof(short), sizeof(float), sizeof(Frequency_MHz)
+};
+
+static const uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+namespace {
+
+  class Writer {
+    FILE * f;
+  public:
+    Writer(FILE * f) : f(f) {};
+
+    void bytes(const void * p, size_t n) {
+      if (fwrite(p, 1, n, f) != n)
+        throw std::runtime_error("Error writing checkpoint file");
+    };
+
+    template < typename T >
+    void val(const T & x) {
+      bytes(& x, sizeof(x));
+    };
+
+    void str(const string & s) {
+      val((uint64_t) s.size());
+      bytes(s.data(), s.size());
+    };
+  };
+
+  class Reader {
+    FILE * f;
+  public:
+    Reader(FILE * f) : f(f) {};
+
+    void bytes(void * p, size_t n) {
+      if (fread(p, 1, n, f) != n)
+        throw std::runtime_error("Checkpoint file is truncated");
+    };
+
+    template < typename T >
+    void val(T & x) {
+      bytes(& x, sizeof(x));
+    };
+
+    uint64_t count() {
+      uint64_t n;
+      val(n);
+      if (n > (1ULL << 32))
+        throw std::runtime_error("Checkpoint file is corrupt");
+      return n;
+    };
+
+    void str(string & s) {
+      s.resize(count());
+      if (s.size() > 0)
+        bytes(& s[0], s.size());
+    };
+  };
+
+  // hits are stored field by field, to avoid writing padding
+
+  void write_hit(Writer & w, const Hit & h) {
+    w.val(h.ts);
+    w.val(h.lid);
+    w.val(h.ant_code);
+    w.val(h.sig);
+    w.val(h.lat);
+    w.val(h.lon);
+    w.val(h.dtaline);
+    w.val(h.ant_freq);
+    w.val(h.gain);
+    w.val(h.codeset_id);
+    w.val(h.seq_no);
+  };
+
+  void read_hit(Reader & r, Hit & h) {
+    r.val(h.ts);
+    r.val(h.lid);
+    r.val(h.ant_code);
+    r.val(h.sig);
+    r.val(h.lat);
+    r.val(h.lon);
+    r.val(h.dtaline);
+    r.val(h.ant_freq);
+    r.val(h.gain);
+    r.val(h.codeset_id);
+    r.val(h.seq_no);
+  };
+};
+
+Checkpoint::Checkpoint() :
+  hits_to_confirm_id(0),
+  burst_slop(0),
+  burst_slop_expansion(0),
+  max_skipped_bursts(0),
+  timestamp_wonkiness(0),
+  last_seq_no(0),
+  last_run_id(0),
+  ant_codes(),
+  codeset_ids(),
+  groups()
+{
+};
+
+void
+Checkpoint::get_params(const Run_Params & params) {
+  hits_to_confirm_id = params.hits_to_confirm_id;
+  burst_slop = params.burst_slop;
+  burst_slop_expansion = params.burst_slop_expansion;
+  max_skipped_bursts = params.max_skipped_bursts;
+  timestamp_wonkiness = params.timestamp_wonkiness;
+};
+
+void
+Checkpoint::check_params(const Run_Params & params) const {
+  if (hits_to_confirm_id != params.hits_to_confirm_id
+      || burst_slop != params.burst_slop
+      || burst_slop_expansion != params.burst_slop_expansion
+      || max_skipped_bursts != params.max_skipped_bursts
+      || timestamp_wonkiness != params.timestamp_wonkiness)
+    throw std::runtime_error("Checkpoint was saved with different values of -b, -B, -c, -S or -t");
+};
+
+void
+Checkpoint::write(const string & filename) const {
+  string tmp = filename + ".tmp";
+  FILE * f = fopen(tmp.c_str(), "wb");
+  if (! f)
+    throw std::runtime_error(string("Couldn't open checkpoint file ") + tmp + " for writing");
+
+  try {
+    Writer w(f);
+    w.bytes(MAGIC, sizeof(MAGIC));
+    w.val(BYTE_ORDER_MARK);
+    w.bytes(TYPE_SIZES, sizeof(TYPE_SIZES));
+
+    w.val(hits_to_confirm_id);
+    w.val(burst_slop);
+    w.val(burst_slop_expansion);
+    w.val(max_skipped_bursts);
+    w.val(timestamp_wonkiness);
+
+    w.val(last_seq_no);
+    w.val(last_run_id);
+    w.val((uint64_t) ant_codes.size());
+    for (auto is = ant_codes.begin(); is != ant_codes.end(); ++is)
+      w.str(*is);
+    w.val((uint64_t) codeset_ids.size());
+    for (auto is = codeset_ids.begin(); is != codeset_ids.end(); ++is)
+      w.str(*is);
+
+    w.val((uint64_t) groups.size());
+    for (auto ig = groups.begin(); ig != groups.end(); ++ig) {
+      w.val(ig->nom_freq);
+      w.val(ig->lid);
+      w.val(ig->num_nodes);
+      for (int i = 0; i < 2; ++i) {
+        w.val((uint64_t) ig->cands[i].size());
+        for (auto ic = ig->cands[i].begin(); ic != ig->cands[i].end(); ++ic) {
+          w.str(ic->tag);
+          w.val(ic->state);
+          w.val(ic->first_ts);
+          w.val(ic->last_ts);
+          w.val(ic->last_dumped_ts);
+          w.val(ic->in_a_row);
+          w.val(ic->bi);
+          w.val(ic->run_id);
+          w.val((uint64_t) ic->hits.size());
+          for (auto ih = ic->hits.begin(); ih != ic->hits.end(); ++ih)
+            write_hit(w, *ih);
+        }
+      }
+    }
+    if (fclose(f) != 0) {
+      f = 0;
+      throw std::runtime_error("Error writing checkpoint file");
+    }
+    f = 0;
+  } catch (...) {
+    if (f)
+      fclose(f);
+    remove(tmp.c_str());
+    throw;
+  }
+
+#ifdef _WIN32
+  // rename() won't replace an existing file here
+  remove(filename.c_str());
+#endif
+  if (rename(tmp.c_str(), filename.c_str()) != 0)
+    throw std::runtime_error(string("Couldn't rename ") + tmp + " to " + filename);
+};
+
+void
+Checkpoint::read(const string & filename) {
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (! f)
+    throw std::runtime_error(string("Couldn't open checkpoint file ") + filename);
+
+  try {
+    Reader r(f);
+    char magic[sizeof(MAGIC)];
+    uint32_t bom;
+    unsigned char sizes[sizeof(TYPE_SIZES)];
+    r.bytes(magic, sizeof(magic));
+    if (memcmp(magic, MAGIC, sizeof(MAGIC)))
+      throw std::runtime_error(filename + " is not a filter_tags checkpoint file");
+    r.val(bom);
+    r.bytes(sizes, sizeof(sizes));
+    if (bom != BYTE_ORDER_MARK || memcmp(sizes, TYPE_SIZES, sizeof(TYPE_SIZES)))
+      throw std::runtime_error(string("Checkpoint file ") + filename + " was written on a different kind of machine");
+
+    r.val(hits_to_confirm_id);
+    r.val(burst_slop);
+    r.val(burst_slop_expansion);
+    r.val(max_skipped_bursts);
+    r.val(timestamp_wonkiness);
+
+    r.val(last_seq_no);
+    r.val(last_run_id);
+    ant_codes.resize(r.count());
+    for (auto is = ant_codes.begin(); is != ant_codes.end(); ++is)
+      r.str(*is);
+    codeset_ids.resize(r.count());
+    for (auto is = codeset_ids.begin(); is != codeset_ids.end(); ++is)
+      r.str(*is);
+
+    groups.resize(r.count());
+    for (auto ig = groups.begin(); ig != groups.end(); ++ig) {
+      r.val(ig->nom_freq);
+      r.val(ig->lid);
+      r.val(ig->num_nodes);
+      for (int i = 0; i < 2; ++i) {
+        ig->cands[i].resize(r.count());
+        for (auto ic = ig->cands[i].begin(); ic != ig->cands[i].end(); ++ic) {
+          r.str(ic->tag);
+          r.val(ic->state);
+          r.val(ic->first_ts);
+          r.val(ic->last_ts);
+          r.val(ic->last_dumped_ts);
+          r.val(ic->in_a_row);
+          r.val(ic->bi);
+          r.val(ic->run_id);
+          ic->hits.resize(r.count());
+          for (auto ih = ic->hits.begin(); ih != ic->hits.end(); ++ih)
+            read_hit(r, *ih);
+        }
+      }
+    }
+    char extra;
+    if (fread(& extra, 1, 1, f) != 0)
+      throw std::runtime_error(string("Checkpoint file ") + filename + " has extra data at the end");
+  } catch (...) {
+    fclose(f);
+    throw;
+  }
+  fclose(f);
+};
@@ -0,0 +1,88 @@
+#ifndef CHECKPOINT_HPP
+#define CHECKPOINT_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit.hpp"
+#include "DFA_Node.hpp"
+#include "Run_Params.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+struct Checkpoint {
+
+  // The complete state of a Run_Foray between two hits, so that a
+  // later invocation can pick up where this one left off: the live
+  // run candidates, the counters used to number hits and runs, and
+  // the antenna and codeset labels hits refer to by index.  Output
+  // from a run on the first part of a stream followed by a resumed
+  // run on the rest is identical to that from a single run on the
+  // whole stream.
+  //
+  // Candidates refer to DFA nodes by index and to tags by full ID, so
+  // the resumed run must use the same tag database and parameters;
+  // read() checks what it can.  The file is in native byte order,
+  // and is only meant to be read back on the same kind of machine.
+
+  struct Candidate {
+    string              tag;            // full ID of confirmed tag; empty if unconfirmed
+    DFA_Node::Index     state;          // index of current node in the lid's DFA_Graph
+    Timestamp           first_ts;
+    Timestamp           last_ts;
+    Timestamp           last_dumped_ts;
+    unsigned int        in_a_row;
+    Gap                 bi;
+    unsigned long long  run_id;         // final, never provisional
+    std::vector < Hit > hits;           // in order of sequence number
+  };
+
+  // the candidates for one Lotek ID at one nominal frequency, on the
+  // confirmed and unconfirmed lists, in list order
+
+  struct Group {
+    Nominal_Frequency_kHz  nom_freq;
+    Lotek_Tag_ID           lid;
+    DFA_Node::Index        num_nodes;   // size of the DFA_Graph, as a consistency check
+    std::vector < Candidate > cands[2];
+  };
+
+  // parameters which must be the same when resuming
+
+  unsigned int           hits_to_confirm_id;
+  Gap                    burst_slop;
+  Gap                    burst_slop_expansion;
+  unsigned int           max_skipped_bursts;
+  unsigned int           timestamp_wonkiness;
+
+  // counters and labels
+
+  Hit::Seq_No            last_seq_no;
+  unsigned long long     last_run_id;
+  std::vector < string > ant_codes;
+  std::vector < string > codeset_ids;
+
+  std::vector < Group >  groups;
+
+  Checkpoint();
+
+  // record the values of the parameters above from params
+
+  void get_params(const Run_Params & params);
+
+  // throw if params differ from those recorded
+
+  void check_params(const Run_Params & params) const;
+
+  // write to filename, replacing any existing file only once the new
+  // one is complete; throws on error
+
+  void write(const string & filename) const;
+
+  // read from filename; throws if it can't be read or is not a
+  // checkpoint from this build
+
+  void read(const string & filename);
+};
+
+#endif // CHECKPOINT_HPP
@@ -0,0 +1,207 @@
+#include "Column_Hit_Source.hpp"
+
+#include "Binary_Format.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <sstream>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+const char Column_Hit_Source::MAGIC[8] = {'F', 'T', 'A', 'G', 'H', 'I', 'T', '1'};
+
+Column_Hit_Source::Column_Hit_Source(const string & filename) :
+  filename(filename),
+  base(0),
+  size(0),
+  mapped(false),
+  num_hits(0),
+  labels(),
+  ant_codes(),
+  codeset_ids(),
+  no_codeset_id(-1),
+  i(0),
+  block_begin(0),
+  block_end(0)
+{
+  load();
+  try {
+    parse();
+  } catch (...) {
+    unload();
+    throw;
+  }
+};
+
+Column_Hit_Source::~Column_Hit_Source() {
+  unload();
+};
+
+void
+Column_Hit_Source::unload() {
+#ifndef _WIN32
+  if (mapped)
+    munmap((void *) base, size);
+  else
+#endif
+    delete [] (const uint64_t *) base;
+  base = 0;
+};
+
+void
+Column_Hit_Source::load() {
+#ifndef _WIN32
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error(string("Couldn't open input file ") + filename);
+  struct stat st;
+  if (fstat(fd, & st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void * p = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p != MAP_FAILED) {
+      ::close(fd);
+      madvise(p, st.st_size, MADV_SEQUENTIAL);
+      base = (const char *) p;
+      size = st.st_size;
+      mapped = true;
+      return;
+    }
+  }
+  ::close(fd);
+#endif
+
+  // where the file can't be mapped, read it into 8-byte aligned memory
+
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (! f)
+    throw std::runtime_error(string("Couldn't open input file ") + filename);
+  std::vector < char > buf;
+  char block[1 << 16];
+  size_t n;
+  while ((n = fread(block, 1, sizeof(block), f)) > 0)
+    buf.insert(buf.end(), block, block + n);
+  bool ok = ! ferror(f);
+  fclose(f);
+  if (! ok)
+    throw std::runtime_error(string("Couldn't read input file ") + filename);
+  uint64_t * b = new uint64_t[Binary_Format::padded(buf.size()) / 8 + 1];
+  if (buf.size() > 0)
+    memcpy(b, buf.data(), buf.size());
+  base = (const char *) b;
+  size = buf.size();
+};
+
+void
+Column_Hit_Source::parse() {
+  // check the header, locate each column, and look up the labels
+
+  const size_t HEADER_SIZE = sizeof(MAGIC) + 4 * sizeof(int32_t);
+  if (size < HEADER_SIZE || memcmp(base, MAGIC, sizeof(MAGIC)))
+    throw std::runtime_error(string("Input file ") + filename + " is not a binary column file");
+  int32_t counts[4];
+  Binary_Format::copy_le(counts, base + sizeof(MAGIC), sizeof(int32_t), 4);
+  if (counts[0] < 0 || counts[1] < 0 || counts[2] < 0)
+    throw std::runtime_error(string("Input file ") + filename + " has negative counts in its header");
+  num_hits = counts[0];
+
+  size_t off = HEADER_SIZE;
+  size_t need = off + (size_t) num_hits * (NUM_DOUBLE_COLUMNS * sizeof(double) + NUM_INT_COLUMNS * sizeof(int32_t));
+  if (need > size)
+    throw std::runtime_error(string("Input file ") + filename + " is too short for its number of hits");
+  for (int c = 0; c < NUM_DOUBLE_COLUMNS; ++c, off += (size_t) num_hits * sizeof(double))
+    doubles[c] = base + off;
+  for (int c = 0; c < NUM_INT_COLUMNS; ++c, off += (size_t) num_hits * sizeof(int32_t))
+    ints[c] = base + off;
+
+  size_t block_size = std::min(num_hits, ROWS_PER_BLOCK);
+  for (int c = 0; c < NUM_DOUBLE_COLUMNS; ++c)
+    block_doubles[c].resize(block_size);
+  for (int c = 0; c < NUM_INT_COLUMNS; ++c)
+    block_ints[c].resize(block_size);
+
+  for (int t = 1; t <= 2; ++t) {
+    for (int32_t k = 0; k < counts[t]; ++k) {
+      const char * end = (const char *) memchr(base + off, 0, size - off);
+      if (! end)
+        throw std::runtime_error(string("Input file ") + filename + " is too short for its number of labels");
+      labels[t - 1].push_back(string(base + off, end - base - off));
+      off = end - base + 1;
+    }
+  }
+};
+
+void
+Column_Hit_Source::code_labels() {
+  for (auto il = labels[0].begin(); il != labels[0].end(); ++il)
+    ant_codes.push_back(codes->ant_codes.add(*il));
+  for (auto il = labels[1].begin(); il != labels[1].end(); ++il)
+    codeset_ids.push_back(codes->codeset_ids.add(*il));
+};
+
+void
+Column_Hit_Source::refill() {
+  block_begin = i;
+  block_end = std::min(num_hits, i + ROWS_PER_BLOCK);
+  size_t n = block_end - block_begin;
+  for (int c = 0; c < NUM_DOUBLE_COLUMNS; ++c) {
+    Binary_Format::copy_le(block_doubles[c].data(), doubles[c] + (size_t) i * sizeof(double), sizeof(double), n);
+  }
+  for (int c = 0; c < NUM_INT_COLUMNS; ++c) {
+    Binary_Format::copy_le(block_ints[c].data(), ints[c] + (size_t) i * sizeof(int32_t), sizeof(int32_t), n);
+  }
+};
+
+double
+Column_Hit_Source::get_double(Double_Column c) const {
+  return block_doubles[c][i - block_begin];
+};
+
+int32_t
+Column_Hit_Source::get_int(Int_Column c) const {
+  return block_ints[c][i - block_begin];
+};
+
+void
+Column_Hit_Source::bad_hit(const char * what) const {
+  std::ostringstream msg;
+  msg << "Input file " << filename << ": " << what << " for hit " << (i + 1);
+  throw std::runtime_error(msg.str());
+};
+
+bool
+Column_Hit_Source::next(Hit &h) {
+  if (i >= num_hits)
+    return false;
+  if (i == 0)
+    code_labels();
+  if (i >= block_end)
+    refill();
+
+  int32_t ant = get_int(ANT);
+  if (ant < 0 || (size_t) ant >= ant_codes.size())
+    bad_hit("antenna label index out of range");
+  int32_t codeset = get_int(CODESET);
+  int codeset_id = 0;
+  if (codeset == -1) {
+    if (no_codeset_id < 0)
+      no_codeset_id = codes->codeset_ids.add(std::string());
+    codeset_id = no_codeset_id;
+  } else if (codeset < 0 || (size_t) codeset >= codeset_ids.size()) {
+    bad_hit("codeset index out of range");
+  } else {
+    codeset_id = codeset_ids[codeset];
+  }
+  int32_t sig = get_int(SIG), gain = get_int(GAIN);
+  if (sig < -32768 || sig > 32767 || gain < -32768 || gain > 32767)
+    bad_hit("signal strength or gain doesn't fit in 16 bits");
+
+  h = Hit::make(codes, get_double(TS), get_int(ID), ant_codes[ant], sig, get_double(LAT), get_double(LON),
+                get_int(DTALINE), get_double(ANT_FREQ), gain, codeset_id);
+  ++i;
+  return true;
+};
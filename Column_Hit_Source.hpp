@@ -0,0 +1,106 @@
+#ifndef COLUMN_HIT_SOURCE_HPP
+#define COLUMN_HIT_SOURCE_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit_Source.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+class Column_Hit_Source : public Hit_Source {
+
+  // hits from a file of fixed-width binary columns, mapped into
+  // memory, so that no text is parsed.  It holds the same fields as
+  // the .CSV input, and is laid out so that R's writeBin() can write
+  // it straight from numeric vectors.  All values are little-endian:
+  //
+  //   magic:   8 bytes "FTAGHIT1"
+  //   header:  4 int32: n (number of hits), a (number of antenna
+  //            labels), c (number of codesets), 0
+  //   columns: n double each: ts, lat, lon, antfreq
+  //            n int32 each:  id, ant, sig, dtaline, gain, codeset
+  //   labels:  a antenna labels, then c codesets, each a string
+  //            ending in a NUL byte
+  //
+  // ant is an index into the antenna labels, from 0.  codeset is an
+  // index into the codesets, or -1 for none.  sig and gain must fit
+  // in 16 bits.  The doubles come first so that every column is
+  // aligned for its type without padding.  From R, for example:
+  //
+  //   f <- file("hits.fth", "wb")
+  //   writeBin(charToRaw("FTAGHIT1"), f)
+  //   writeBin(c(n, length(ants), length(codesets), 0L), f, endian="little")
+  //   for (x in list(ts, lat, lon, antfreq)) writeBin(as.double(x), f, endian="little")
+  //   for (x in list(id, ant, sig, dtaline, gain, codeset)) writeBin(as.integer(x), f, endian="little")
+  //   writeBin(c(ants, codesets), f)
+  //   close(f)
+  //
+  // Antenna labels and codesets are each looked up once per file,
+  // rather than once per hit.  Columns are decoded a block of rows at
+  // a time, so each column is read sequentially in large pieces.
+
+protected:
+  static const char MAGIC[8];
+  static const uint32_t ROWS_PER_BLOCK = 4096;
+
+  enum Double_Column {TS, LAT, LON, ANT_FREQ, NUM_DOUBLE_COLUMNS};
+  enum Int_Column {ID, ANT, SIG, DTALINE, GAIN, CODESET, NUM_INT_COLUMNS};
+
+  string filename;
+  const char * base;   // the file's contents
+  size_t size;
+  bool mapped;         // is base mapped (rather than allocated)?
+
+  uint32_t num_hits;
+  const char * doubles[NUM_DOUBLE_COLUMNS];
+  const char * ints[NUM_INT_COLUMNS];
+
+  std::vector < string > labels[2];  // antenna labels, then codesets, as in the file
+  std::vector < int > ant_codes;     // codes->ant_codes for each antenna label, once hits are read
+  std::vector < int > codeset_ids;   // codes->codeset_ids for each codeset, once hits are read
+  int no_codeset_id;                 // for codeset -1
+
+  uint32_t i;          // index of the next hit
+
+  // columns for hits block_begin up to block_end, in host order
+
+  uint32_t block_begin;
+  uint32_t block_end;
+  std::vector < double > block_doubles[NUM_DOUBLE_COLUMNS];
+  std::vector < int32_t > block_ints[NUM_INT_COLUMNS];
+
+  void load();
+
+  void unload();
+
+  void parse();
+
+  // look up the labels in codes, before the first hit is made
+
+  void code_labels();
+
+  // decode the block of rows starting at hit i
+
+  void refill();
+
+  double get_double(Double_Column c) const;
+
+  int32_t get_int(Int_Column c) const;
+
+  // throw an error about hit i
+
+  void bad_hit(const char * what) const;
+
+public:
+
+  // map filename; throws if it can't be read or isn't a valid file
+
+  Column_Hit_Source(const string & filename);
+
+  ~Column_Hit_Source();
+
+  bool next(Hit &h);
+};
+
+#endif // COLUMN_HIT_SOURCE_HPP
@@ -1,14 +1,26 @@
 #include "DFA_Graph.hpp"
 
+#include <cmath>
+#include <algorithm>
+
 DFA_Graph::DFA_Graph(unsigned int max_depth) :
   max_depth(max_depth),
-
-  // NB: preallocate the vector of node sets so that iterators to particular
-  // sets are not invalidated by reallocation of the vector as it grows.
-  
-  root(0),
+  nodes(),
+  icl_edges(),
+  edge_lo(),
+  edge_hi(),
+  edge_to(),
+  id_set_index(),
+  id_sets(),
   N(max_depth),
-  tags()
+  tags(),
+  tag_list(),
+  ambiguous(false),
+  node_base(0),
+  node_count(0),
+  lo_base(0),
+  hi_base(0),
+  to_base(0)
 {
 };
 
@@ -24,38 +36,60 @@ DFA_Graph::add_tag (Known_Tag *t) {
   tags.insert(t);
 };
 
+DFA_Graph::Index
+DFA_Graph::intern(const Tag_ID_Set & s) {
+  auto it = id_set_index.find(s);
+  if (it != id_set_index.end())
+    return it->second;
+  Index i = id_sets.size();
+  it = id_set_index.insert(std::make_pair(s, i)).first;
+  id_sets.push_back(& it->first);
+  return i;
+};
+
+DFA_Graph::Index
+DFA_Graph::add_node(unsigned int depth, const Tag_ID_Set & s) {
+  Index i = nodes.size();
+  Index first_tag = std::lower_bound(tag_list.begin(), tag_list.end(), *s.begin()) - tag_list.begin();
+  nodes.push_back(DFA_Node(depth, intern(s), first_tag, s.size()));
+  icl_edges.push_back(Edges());
+  return i;
+};
+
 void 
 DFA_Graph::setup_root() {
-  if (! root) {
-    // create the root with all known tag IDs in its set
-    root = new DFA_Node(0);
-    for (auto it = tags.begin(); it != tags.end(); ++it)
-      root->ids.insert(*it);
-    N[0][root->ids] = root;
+  if (nodes.size() == 0) {
+    // create the root with all known tag IDs in its set; tag_list is
+    // in the set's order, so it can be searched
+    tag_list.assign(tags.begin(), tags.end());
+    Index root = add_node(0, tags);
+    N[0][tags] = root;
   };
 };
   
 DFA_Node *
 DFA_Graph::get_root() {
-  return root;
+  return node_count > 0 ? node_base : 0;
+};
+
+const Tag_ID_Set &
+DFA_Graph::get_ids(Index p) {
+  return * id_sets[nodes[p].ids];
 };
 
 // grow the DFA_Graph from a node via an interval_map; edges are added
 // between the specified node and (possibly new nodes) at the specified
-// depth.  "Edges" are really (interval < Gap > , Node*), collected
+// depth.  "Edges" are really (interval < Gap > , node index), collected
 // in an interval_map.
 
 void 
-DFA_Graph::grow(DFA_Node *p, interval_map < Gap, Tag_ID_Set > &s, unsigned int depth) {
-
-  if (!p)
-    p = root;
+DFA_Graph::grow(Index p, interval_map < Gap, Tag_ID_Set > &s, unsigned int depth) {
 
   if (depth > N.size())
     throw std::runtime_error("Internal error: attempt to increase depth by more than 1.\n");
 
   if (depth == N.size())
-    N[N.size()] = Node_Map();
+    N.push_back(Node_Map());
 
   Node_Map & Nd = N[depth];
 
@@ -65,17 +99,135 @@ DFA_Graph::grow(DFA_Node *p, interval_map < Gap, Tag_ID_Set > &s, unsigned int d
   // problem.
     
   for (auto it = s.begin(); it != s.end(); ++it) {
-    DFA_Node *n;
-    if (Nd.count(it->second) == 0) {
-      Nd[it->second] = n = new DFA_Node(p->depth + 1, it->second);
+    Index n;
+    auto in = Nd.find(it->second);
+    if (in == Nd.end()) {
+      Nd[it->second] = n = add_node(nodes[p].depth + 1, it->second);
     } else {
-      n = Nd[it->second];
+      n = in->second;
     }
-    p->edges.set(make_pair(it->first, n));
+    icl_edges[p].set(make_pair(it->first, n));
   }
 
   // ensure the node's max age is correct, given we may have added
   // edges with larger gap sizes
 
-  p->set_max_age();
+  set_max_age(p);
+};
+
+void
+DFA_Graph::set_max_age(Index p) {
+
+  // set the maximum time before death for a DFA in this state
+  // This is the longest time we can wait for a pulse that will
+  // still lead to a valid NDFA node.
+
+  Edges & e = icl_edges[p];
+  if (e.size() > 0)
+    nodes[p].max_age = upper(e.rbegin()->first);
+  else
+    nodes[p].max_age = -1;
+};
+
+void
+DFA_Graph::compile() {
+  edge_lo.clear();
+  edge_hi.clear();
+  edge_to.clear();
+
+  for (Index i = 0; i < nodes.size(); ++i) {
+    DFA_Node & n = nodes[i];
+    n.first_edge = edge_lo.size();
+    for (auto it = icl_edges[i].begin(); it != icl_edges[i].end(); ++it) {
+      Gap lo = lower(it->first);
+      Gap hi = upper(it->first);
+      if (! is_left_closed(it->first.bounds()))
+        lo = nextafterf(lo, HUGE_VALF);
+      if (! is_right_closed(it->first.bounds()))
+        hi = nextafterf(hi, -HUGE_VALF);
+      if (lo > hi)
+        continue; // an open interval with no Gap inside it
+      edge_lo.push_back(lo);
+      edge_hi.push_back(hi);
+      edge_to.push_back(it->second);
+    }
+    n.num_edges = edge_lo.size() - n.first_edge;
+  }
+
+  std::vector < Node_Map > ().swap(N);
+  if (DFA_Node::use_flat_edges)
+    std::vector < Edges > ().swap(icl_edges);
+
+  node_base = nodes.data();
+  node_count = nodes.size();
+  lo_base = edge_lo.data();
+  hi_base = edge_hi.data();
+  to_base = edge_to.data();
+};
+
+DFA_Node *
+DFA_Graph::next(DFA_Node * n, Gap bi) {
+
+  // return the DFA_Node obtained by following the edge labelled "bi",
+  // or NULL if no such edge exists.  i.e. move to the state representing
+  // those tag IDs which are compatible with the current set of tag IDs
+  // and with the specified the specified gap to the next burst.
+
+  if (! DFA_Node::use_flat_edges) {
+    Edges & e = icl_edges[n - node_base];
+    auto it = e.find(bi);
+    if (it == e.end())
+      return 0;
+    else
+      return & node_base[it->second];
+  }
+
+  // find the first interval whose upper bound is not below bi; bi is
+  // on that edge if it is also not below the interval's lower bound.
+
+  size_t len = n->num_edges;
+  if (len == 0)
+    return 0;
+
+  const Gap * hi = hi_base + n->first_edge;
+  size_t i;
+  if (len <= MAX_LINEAR_EDGES) {
+    for (i = 0; i < len && hi[i] < bi; ++i)
+      /**/;
+    if (i == len)
+      return 0;
+  } else {
+    // branchless lower bound
+    const Gap * b = hi;
+    while (len > 1) {
+      size_t half = len / 2;
+      b += (b[half - 1] < bi) ? half : 0;
+      len -= half;
+    }
+    if (*b < bi)
+      return 0;
+    i = b - hi;
+  }
+  i += n->first_edge;
+  if (lo_base[i] <= bi)
+    return & node_base[to_base[i]];
+  return 0;
+};
+
+void
+DFA_Graph::dump(ostream & os) {
+
+  // output each node and its (compiled) edges
+
+  // (tag ID sets are not kept for graphs from a Graph_Cache)
+
+  for (Index i = 0; i < node_count; ++i) {
+    DFA_Node & n = node_base[i];
+    os << "NODE " << i << " @ depth " << n.depth << " ; max age: " << n.max_age << "\n";
+    if (id_sets.size() > 0)
+      os << "Tags: " << get_ids(i) << "\n";
+    os << "Edges:" << "\n";
+    for (Index j = n.first_edge; j < n.first_edge + n.num_edges; ++j)
+      os << "[" << lo_base[j] << ", " << hi_base[j] << "] -> NODE " << to_base[j] << endl;
+  }
 };
@@ -7,11 +7,10 @@
 #include "Known_Tag.hpp"
 
 #include <vector>
-#include <unordered_set>
-#include <unordered_map>
+#include <map>
 
-// a type to map sets of tag Ids to DFA nodes
-typedef std::map < Tag_ID_Set, DFA_Node * > Node_Map;
+// a type to map sets of tag Ids to DFA nodes (by index)
+typedef std::map < Tag_ID_Set, DFA_Node::Index > Node_Map;
 
 class DFA_Graph {
   // the graph representing a DFA for recognizing sequences of
@@ -28,32 +27,88 @@ class DFA_Graph {
 
   // The Run_Finder class gets access to the root and sets of nodes at each depth.
 
+  // All storage for nodes, edges and tag ID sets is owned by the graph
+  // and released with it, except that a compiled graph's nodes and
+  // edges can instead be mapped from a Graph_Cache.  Nodes refer to
+  // each other by index, so a graph can be copied or moved freely
+  // until it is compiled.
+
   friend class Run_Finder;
+  friend class Graph_Cache;
 
 public:
+  typedef DFA_Node::Index Index;
 
+  // "Edges" are really (interval < Gap > , node index), collected in an
+  // interval_map; partial_enricher so that index 0 (the root) is kept
+  typedef interval_map < Gap, Index, partial_enricher > Edges;
 
 protected:
   // the max depth of this graph
 
   unsigned int max_depth;
 
-  // the root node, where any DFA begins its life
+  // the nodes; the root node, where any DFA begins its life, is
+  // nodes[0], once setup_root() has been called
+
+  std::vector < DFA_Node > nodes;
+
+  // edges from each node, by node index, as built.  These are released
+  // by compile() unless DFA_Node::use_flat_edges is false.
+
+  std::vector < Edges > icl_edges;
+
+  // compiled edges of all nodes: the disjoint intervals of each node's
+  // edges, in increasing order, as parallel arrays of lower bounds,
+  // upper bounds and targets.  Open bounds are stored as the nearest
+  // Gap inside the interval, so x is in interval i exactly when
+  // edge_lo[i] <= x <= edge_hi[i].
+
+  std::vector < Gap > edge_lo;
+  std::vector < Gap > edge_hi;
+  std::vector < Index > edge_to;
+
+  static const unsigned int MAX_LINEAR_EDGES = 8; // use a linear scan for up to this many edges
+
+  // pool of distinct tag ID sets used by nodes; id_sets[i] points to
+  // the key of id_set_index with value i.
 
-  DFA_Node * root;
+  std::map < Tag_ID_Set, Index > id_set_index;
+  std::vector < const Tag_ID_Set * > id_sets;
 
   // at each depth, there is a map from sets of tag IDs
   // to nodes
 
-
   // For each depth, the nodes are in a Node_Map, indexed
   // by Tag_ID_Set
   // These are collected into a vector, indexed by depth.
+  // Only needed while building the graph.
   std::vector < Node_Map > N;
 
-  // The set of tags for this graph
+  // The set of tags for this graph, and the same in order, as
+  // indexed by a node's first_tag
 
   Tag_ID_Set tags;
+  std::vector < Known_Tag * > tag_list;
+
+  // can some tags not be told apart, even at max_depth?
+
+  bool ambiguous;
+
+  // the compiled nodes and edges walked by next(): either the vectors
+  // above, or arrays mapped from a Graph_Cache
+
+  DFA_Node * node_base;
+  Index node_count;
+  const Gap * lo_base;
+  const Gap * hi_base;
+  const Index * to_base;
+
+  Index intern(const Tag_ID_Set & s);
+
+  Index add_node(unsigned int depth, const Tag_ID_Set & s);
+
+  void set_max_age(Index p);
 
 public:
 
@@ -65,12 +120,42 @@ public:
 
   DFA_Node *get_root();
 
+  // nodes are identified across invocations by their index; building
+  // the graph from the same tags always numbers them the same way
+
+  Index index_of(const DFA_Node * n) const {return n - node_base;};
+
+  DFA_Node * node_at(Index i) {return & node_base[i];};
+
+  Index num_nodes() const {return node_count;};
+
+  // has the graph been compiled (or mapped from a Graph_Cache)?
+
+  bool is_built() const {return node_count > 0;};
+
+  // the tag ID of a node; the first of its tags, if is_unique() is false
+
+  Tag_ID get_ID(const DFA_Node * n) {return tag_list[n->first_tag];};
+
+  const Tag_ID_Set & get_ids(Index p);
+
   // grow the DFA_Graph from a node via an interval_map; edges are added
   // between the specified node and (possibly new nodes) at the specified
-  // depth.  "Edges" are really (interval < Gap > , Node*), collected
-  // in an interval_map.
+  // depth.
+
+  void grow(Index p, interval_map < Gap, Tag_ID_Set > &s, unsigned int depth);
+
+  // compile the edges of every node, once the graph is complete;
+  // this also releases storage only needed while building it
+
+  void compile();
+
+  // return the node obtained by following the edge from n labelled
+  // "bi", or NULL if no such edge exists.
+
+  DFA_Node * next(DFA_Node * n, Gap bi);
 
-  void grow(DFA_Node *p, interval_map < Gap, Tag_ID_Set > &s, unsigned int depth);
+  void dump(ostream & os);
 };
 
 #endif // DFA_GRAPH_HPP
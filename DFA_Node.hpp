@@ -6,48 +6,50 @@
 #include <boost/icl/interval_map.hpp>
 using namespace boost::icl;
 
+#include <stdint.h>
+
 class DFA_Node {
 
+  // A state in a DFA_Graph.  Nodes live in an array owned by their
+  // graph, and refer to other nodes, tag ID sets, edges and tags by
+  // 32-bit index into arrays also owned by the graph, so a node is
+  // small, a graph's nodes are contiguous, and they can be saved to
+  // and mapped from a Graph_Cache as-is.  The graph does the walking;
+  // see DFA_Graph::next().
+
   friend class DFA_Graph;
   friend class Run_Finder;
+  friend class Graph_Cache;
 
-protected:
-  typedef interval_map < Gap, DFA_Node * > Edges;
-  typedef Edges :: iterator Edge_iterator;
-  typedef Edges :: const_iterator Const_Edge_iterator;
+public:
+  typedef uint32_t Index;
 
+protected:
   // fundamental structure
 
-  unsigned int	depth;		// depth of this node in the tree
-  Tag_ID_Set	ids;		// ids of tags in this node; these would all correspond to
-                                // tags with the same lotek ID, but possibly different burst intervals
-  Edges		edges;		// interval map from gap to other nodes
   Gap	        max_age;	// maximum time a DFA can remain in
                                 // this state.  If a DFA in this state
                                 // goes longer than this without
                                 // adding a burst, then its run is terminated and it is destroyed.
-  unsigned long long node_id;   // for internal use; unique
-
-  static unsigned long long get_unique_node_id(); // for internal use
+  unsigned int	depth;		// depth of this node in the tree
+  Index         ids;            // index of this node's set of tag ids in the graph's pool; these
+                                // would all correspond to tags with the same lotek ID, but possibly
+                                // different burst intervals
+  Index         first_edge;     // compiled edges are at [first_edge, first_edge + num_edges)
+  Index         num_edges;      // in the graph's edge arrays
+  Index         first_tag;      // index in the graph's tag list of the first tag ID in ids
+  Index         num_tags;       // number of tag IDs in ids
 
 public:  
-  DFA_Node(unsigned int depth);
-
-  DFA_Node(unsigned int depth, const Tag_ID_Set &ids);
-
-  DFA_Node * next (Gap bi);
+  DFA_Node(unsigned int depth, Index ids, Index first_tag, Index num_tags);
 
   bool is_unique();
 
-  void set_max_age();
-
   Gap get_max_age();
 
-  Tag_ID get_ID();
-
-  void dump(ostream & os, string indent = "", string indent_change = "   ");
-    
+  // when walking a graph, use compiled edges?  (otherwise, the
+  // interval_maps they were compiled from)
+  static bool use_flat_edges;
 };
 
 #endif // DFA_NODE_HPP
-
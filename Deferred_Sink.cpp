@@ -0,0 +1,122 @@
+#include "Deferred_Sink.hpp"
+
+#include <algorithm>
+
+Deferred_Sink::Deferred_Sink() :
+  trigger(0),
+  batch()
+{
+};
+
+void
+Deferred_Sink::begin_hit(const Hit &h) {
+  trigger = h.seq_no;
+};
+
+unsigned long long
+Deferred_Sink::new_run_id(const Hit &h) {
+  batch.new_runs.push_back(h.seq_no);
+  return h.seq_no;
+};
+
+void
+Deferred_Sink::put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+  Record r = {trigger, prefix, h, tag, run_id, pos_in_run, burst_slop};
+  batch.records.push_back(r);
+};
+
+void
+Deferred_Sink::end_run(unsigned long long run_id) {
+  batch.ended_runs.push_back(run_id);
+};
+
+bool
+Deferred_Sink::is_empty() {
+  return batch.records.empty() && batch.new_runs.empty() && batch.ended_runs.empty();
+};
+
+void
+Deferred_Sink::take(Batch &b) {
+  b.records.clear();
+  b.new_runs.clear();
+  b.ended_runs.clear();
+  std::swap(b, batch);
+};
+
+Deferred_Merger::Deferred_Merger(Output_Sink *out, Hit_Codes *codes) :
+  out(out),
+  first_seq(codes->last_seq_no + 1),
+  base_run_id(out->get_last_run_id()),
+  num_started(0),
+  started(),
+  started_before()
+{
+};
+
+void
+Deferred_Merger::note_new_run(Hit::Seq_No s) {
+  s -= first_seq;
+  ++num_started;
+  size_t w = s / 64;
+  if (started.size() <= w)
+    started.resize(w + 1, 0);
+  started[w] |= 1ULL << (s % 64);
+};
+
+unsigned long long
+Deferred_Merger::final_run_id(unsigned long long run_id) {
+  // all runs started before s have been noted, so prefix counts for
+  // words up to the one holding s will not change again
+
+  // run IDs never exceed the number of hits made, so restored ones
+  // are all below first_seq
+
+  if (run_id < (unsigned long long) first_seq)
+    return run_id;
+  Hit::Seq_No s = run_id - first_seq;
+  size_t w = s / 64;
+  while (started_before.size() <= w) {
+    size_t i = started_before.size();
+    started_before.push_back(i == 0 ? 0 : started_before[i - 1] + __builtin_popcountll(started[i - 1]));
+  }
+  int b = s % 64;
+  uint64_t mask = b == 63 ? ~0ULL : (1ULL << (b + 1)) - 1;
+  return base_run_id + started_before[w] + __builtin_popcountll(started[w] & mask);
+};
+
+unsigned long long
+Deferred_Merger::get_last_run_id() {
+  return base_run_id + num_started;
+};
+
+void
+Deferred_Merger::merge(std::vector < Deferred_Sink::Batch * > & batches) {
+
+  for (auto ib = batches.begin(); ib != batches.end(); ++ib)
+    for (auto is = (*ib)->new_runs.begin(); is != (*ib)->new_runs.end(); ++is)
+      note_new_run(*is);
+
+  // records from any one batch are already in trigger order, and no
+  // two batches have records with the same trigger, so a stable sort
+  // on trigger recovers the single-threaded output order.
+
+  std::vector < const Deferred_Sink::Record * > recs;
+  for (auto ib = batches.begin(); ib != batches.end(); ++ib)
+    for (auto ir = (*ib)->records.begin(); ir != (*ib)->records.end(); ++ir)
+      recs.push_back(& *ir);
+
+  std::stable_sort(recs.begin(), recs.end(),
+                   [](const Deferred_Sink::Record *a, const Deferred_Sink::Record *b) {return a->trigger < b->trigger;});
+
+  for (auto ir = recs.begin(); ir != recs.end(); ++ir) {
+    const Deferred_Sink::Record &r = **ir;
+    out->put(r.prefix, r.hit, r.tag, final_run_id(r.run_id), r.pos_in_run, r.burst_slop);
+  }
+
+  // a run's hits all come from the same sink as its end, and precede
+  // it there, so they have all been put by now
+
+  for (auto ib = batches.begin(); ib != batches.end(); ++ib)
+    for (auto ie = (*ib)->ended_runs.begin(); ie != (*ib)->ended_runs.end(); ++ie)
+      out->end_run(final_run_id(*ie));
+};
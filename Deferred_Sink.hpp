@@ -0,0 +1,113 @@
+#ifndef DEFERRED_SINK_HPP
+#define DEFERRED_SINK_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Output_Sink.hpp"
+
+#include <vector>
+#include <stdint.h>
+
+class Deferred_Sink : public Output_Sink {
+
+  // An Output_Sink for a Run_Finder (or part of one) running on a
+  // worker thread.  Rather than writing hits, it records them, along
+  // with the sequence number of the input hit whose processing
+  // generated them.  Run IDs handed out are provisional: the sequence
+  // number of the hit that started the run.  A Deferred_Merger
+  // later combines the records from all workers in input order, and
+  // renumbers runs exactly as a single-threaded Run_Foray would have.
+
+public:
+
+  struct Record {
+    Hit::Seq_No         trigger;       // input hit being processed when this was output
+    string              prefix;
+    Hit                 hit;
+    Known_Tag          *tag;
+    unsigned long long  run_id;        // provisional
+    unsigned int        pos_in_run;
+    double              burst_slop;
+  };
+
+  // everything output while processing one batch of input hits
+
+  struct Batch {
+    std::vector < Record > records;       // ordered by trigger
+    std::vector < Hit::Seq_No > new_runs; // in increasing order
+    std::vector < unsigned long long > ended_runs; // provisional IDs
+  };
+
+protected:
+  Hit::Seq_No trigger;
+  Batch       batch;
+
+public:
+
+  Deferred_Sink();
+
+  // note that subsequent output is due to processing hit h
+
+  void begin_hit(const Hit &h);
+
+  unsigned long long new_run_id(const Hit &h);
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop);
+
+  void end_run(unsigned long long run_id);
+
+  // has anything been recorded since the last take()?
+
+  bool is_empty();
+
+  // move everything recorded so far into b, leaving this sink empty
+
+  void take(Batch &b);
+};
+
+class Deferred_Merger {
+
+  // combine batches from Deferred_Sinks covering the same range of
+  // input hits, writing them to a real Output_Sink in input order.
+  // Batches must be merged in the order of the input ranges they
+  // cover.  Runs ended in a batch are passed to the Output_Sink's
+  // end_run() under their final IDs, after all of the batch's hits.
+
+protected:
+  Output_Sink * out;
+
+  // a bit for each input sequence number from first_seq on, set if
+  // the hit started a run, and the count of such bits before each
+  // 64-bit word; the final run ID for a provisional one is its rank
+  // among all runs started so far, after the base_run_id runs numbered
+  // before the merger was created.
+
+  Hit::Seq_No first_seq;
+  unsigned long long base_run_id;
+  unsigned long long num_started;
+  std::vector < uint64_t > started;
+  std::vector < unsigned long long > started_before;
+
+  void note_new_run(Hit::Seq_No s);
+
+public:
+
+  // create a merger for hits made after it is with codes
+
+  Deferred_Merger(Output_Sink *out, Hit_Codes *codes);
+
+  void merge(std::vector < Deferred_Sink::Batch * > & batches);
+
+  // the final ID of run_id, once all batches up to the one which
+  // started the run have been merged.  IDs of runs started before
+  // the merger was created (i.e. restored from a checkpoint) are
+  // already final.
+
+  unsigned long long final_run_id(unsigned long long run_id);
+
+  // the final ID of the last run started in the batches merged so far
+
+  unsigned long long get_last_run_id();
+};
+
+#endif // DEFERRED_SINK_HPP
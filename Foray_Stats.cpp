@@ -0,0 +1,58 @@
+#include "Foray_Stats.hpp"
+
+#include <string.h>
+
+Foray_Stats::Foray_Stats() {
+  memset(this, 0, sizeof(*this));
+};
+
+void
+Foray_Stats::add(const Foray_Stats & s) {
+  cands_created += s.cands_created;
+  cands_cloned += s.cands_cloned;
+  cands_expired += s.cands_expired;
+  cands_confirmed += s.cands_confirmed;
+  cands_killed += s.cands_killed;
+  cands_evicted += s.cands_evicted;
+  dfa_lookups += s.dfa_lookups;
+  dfa_misses += s.dfa_misses;
+  hits_bogus += s.hits_bogus;
+  hits_not_in_db += s.hits_not_in_db;
+  for (int i = 0; i < Log2_Histogram::NUM_BUCKETS; ++i)
+    cand_list_lengths.n[i] += s.cand_list_lengths.n[i];
+  parse_ns += s.parse_ns;
+  process_ns += s.process_ns;
+  dump_ns += s.dump_ns;
+};
+
+void
+Foray_Stats::report(ostream & out) {
+  out << "Run finding statistics:\n"
+      << "  candidates created:    " << cands_created << '\n'
+      << "  candidates cloned:     " << cands_cloned << '\n'
+      << "  candidates expired:    " << cands_expired << '\n'
+      << "  candidates confirmed:  " << cands_confirmed << '\n'
+      << "  candidates killed:     " << cands_killed << '\n'
+      << "  candidates evicted:    " << cands_evicted << '\n'
+      << "  DFA lookups:           " << dfa_lookups << '\n'
+      << "  DFA misses:            " << dfa_misses << '\n'
+      << "  hits with ID 999:      " << hits_bogus << '\n'
+      << "  hits not in database:  " << hits_not_in_db << '\n'
+      << "  seconds parsing:       " << parse_ns / 1e9 << '\n'
+      << "  seconds processing:    " << process_ns / 1e9 << '\n'
+      << "  seconds dumping:       " << dump_ns / 1e9 << '\n'
+      << "  live candidates for a hit's Lotek ID:\n";
+
+  int last = Log2_Histogram::NUM_BUCKETS - 1;
+  while (last > 0 && cand_list_lengths.n[last] == 0)
+    --last;
+  for (int b = 0; b <= last; ++b) {
+    unsigned long long lo = b == 0 ? 0 : 1ULL << (b - 1);
+    unsigned long long hi = b == 0 ? 0 : (1ULL << b) - 1;
+    out << "    " << lo;
+    if (hi > lo)
+      out << '-' << hi;
+    out << ": " << cand_list_lengths.n[b] << '\n';
+  }
+  out.flush();
+};
@@ -0,0 +1,92 @@
+#ifndef FORAY_STATS_HPP
+#define FORAY_STATS_HPP
+
+#include "filter_tags_common.hpp"
+
+#include <chrono>
+
+/*
+  Foray_Stats - counters and timers for seeing where run finding
+  spends its effort.
+
+  These are only kept when compiled with -DFILTER_TAGS_STATS (see the
+  Makefile); otherwise FT_STAT() discards its argument, so none of
+  this costs anything.  Each Run_Finder has its own Foray_Stats, only
+  ever updated by the thread processing that Run_Finder's hits, so
+  no locks or atomics are needed; Run_Foray adds them together after
+  processing.
+*/
+
+#ifdef FILTER_TAGS_STATS
+#define FT_STAT(x) x
+#else
+#define FT_STAT(x)
+#endif
+
+struct Foray_Stats {
+
+  // counts of values falling in buckets [0], [1], [2, 3], [4, 7], ...
+
+  struct Log2_Histogram {
+    static const int NUM_BUCKETS = 32;
+    unsigned long long n[NUM_BUCKETS];
+
+    void add(size_t x) {
+      int b = 0;
+      while (x > 0 && b < NUM_BUCKETS - 1) {
+        x >>= 1;
+        ++b;
+      }
+      ++n[b];
+    };
+  };
+
+  // adds the time from its construction to its destruction to a total
+
+  class Timer {
+    unsigned long long & ns;
+    std::chrono::steady_clock::time_point t0;
+  public:
+    Timer(unsigned long long & ns) : ns(ns), t0(std::chrono::steady_clock::now()) {};
+    ~Timer() {
+      ns += std::chrono::duration_cast < std::chrono::nanoseconds > (std::chrono::steady_clock::now() - t0).count();
+    };
+  };
+
+  // candidates
+
+  unsigned long long cands_created;    // started by a hit no confirmed candidate took
+  unsigned long long cands_cloned;     // copied before an unconfirmed candidate took a hit
+  unsigned long long cands_expired;    // too old to take any further hit
+  unsigned long long cands_confirmed;
+  unsigned long long cands_killed;     // shared a hit with a newly-confirmed candidate
+  unsigned long long cands_evicted;    // over the candidate budget
+
+  // DFA transitions tried, and those with no edge for the gap
+
+  unsigned long long dfa_lookups;
+  unsigned long long dfa_misses;
+
+  // hits not processed
+
+  unsigned long long hits_bogus;       // Lotek ID 999
+  unsigned long long hits_not_in_db;   // no registered tag has the Lotek ID
+
+  // live candidates for a hit's Lotek ID when it arrives
+
+  Log2_Histogram cand_list_lengths;
+
+  // time spent, in nanoseconds; process_ns includes dump_ns
+
+  unsigned long long parse_ns;         // reading hits from input
+  unsigned long long process_ns;       // in Run_Finder::process()
+  unsigned long long dump_ns;          // writing, deferring or merging output
+
+  Foray_Stats();
+
+  void add(const Foray_Stats & s);
+
+  void report(ostream & out);
+};
+
+#endif // FORAY_STATS_HPP
@@ -18,6 +18,10 @@ Frequency_MHz Freq_Setting::as_Frequency_MHz(Nominal_Frequency_kHz x) {
 };
 
 Nominal_Frequency_kHz Freq_Setting::get_closest_nominal_freq(Frequency_MHz freq) {
+  return get_closest_nominal_freq(freq, nominal_freqs);
+};
+
+Nominal_Frequency_kHz Freq_Setting::get_closest_nominal_freq(Frequency_MHz freq, const Freq_Set & nominal_freqs) {
   // easy failsafe
   if (nominal_freqs.size() == 0)
     return as_Nominal_Frequency_kHz(freq);
@@ -30,7 +34,7 @@ Nominal_Frequency_kHz Freq_Setting::get_closest_nominal_freq(Frequency_MHz freq)
   Nominal_Frequency_kHz best = 0.0;
   double best_fit = 1e9;	// something stupidly large
 
-  for (Freq_Set :: iterator it = nominal_freqs.begin(); it != nominal_freqs.end(); ++it) {
+  for (Freq_Set :: const_iterator it = nominal_freqs.begin(); it != nominal_freqs.end(); ++it) {
     double fit = fabs(freq - as_Frequency_MHz(*it));
     if ( fit < best_fit ) {
       best_fit = fit;
@@ -24,6 +24,12 @@ class Freq_Setting {
   static Nominal_Frequency_kHz as_Nominal_Frequency_kHz(Frequency_MHz x);
   static Frequency_MHz as_Frequency_MHz(Nominal_Frequency_kHz x);
   static Nominal_Frequency_kHz get_closest_nominal_freq(Frequency_MHz freq);
+
+  // the frequency in nominal_freqs closest to freq, as above, for
+  // when several sets of tags are in use at once
+
+  static Nominal_Frequency_kHz get_closest_nominal_freq(Frequency_MHz freq, const Freq_Set & nominal_freqs);
+
   static void set_nominal_freqs(const Freq_Set & nominal_freqs);
 };
 
@@ -0,0 +1,323 @@
+#include "Graph_Cache.hpp"
+
+#include "Run_Finder.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+const char Graph_Cache::MAGIC[8] = {'F', 'T', 'A', 'G', 'D', 'F', 'A', '1'};
+
+// FNV-1a, 64-bit
+
+static void
+hash_bytes(uint64_t & h, const void * p, size_t n) {
+  const unsigned char * b = (const unsigned char *) p;
+  for (size_t i = 0; i < n; ++i) {
+    h ^= b[i];
+    h *= 0x100000001b3ULL;
+  }
+};
+
+template < typename T >
+static void
+hash_val(uint64_t & h, const T & x) {
+  hash_bytes(h, & x, sizeof(x));
+};
+
+static size_t
+padded(size_t n) {
+  return (n + 7) & ~ (size_t) 7;
+};
+
+Graph_Cache::Graph_Cache(const char * base, size_t size, bool mapped) :
+  base(base),
+  size(size),
+  mapped(mapped),
+  quiet(false),
+  entries()
+{
+};
+
+Graph_Cache::~Graph_Cache() {
+#ifndef _WIN32
+  if (mapped) {
+    munmap((void *) base, size);
+    return;
+  }
+#endif
+  delete [] (const uint64_t *) base;
+};
+
+uint64_t
+Graph_Cache::get_key(Tag_Database * tags, const Run_Params & params) {
+  uint64_t h = 0xcbf29ce484222325ULL;
+
+  hash_bytes(h, MAGIC, sizeof(MAGIC));
+  hash_val(h, sizeof(DFA_Node));
+  hash_val(h, params.hits_to_confirm_id);
+  hash_val(h, params.burst_slop);
+  hash_val(h, params.burst_slop_expansion);
+  hash_val(h, params.max_skipped_bursts);
+  hash_val(h, params.timestamp_wonkiness);
+
+  // tags in database order, which is also the order of their
+  // pointers, and so of the Tag_ID_Sets graphs are built from
+
+  std::vector < Known_Tag * > all;
+  Freq_Set & nf = tags->get_nominal_freqs();
+  for (auto ifs = nf.begin(); ifs != nf.end(); ++ifs) {
+    Tag_Set * tgs = tags->get_tags_at_freq(*ifs);
+    all.insert(all.end(), tgs->begin(), tgs->end());
+  }
+  std::sort(all.begin(), all.end());
+  for (auto it = all.begin(); it != all.end(); ++it) {
+    hash_val(h, (*it)->lid);
+    hash_val(h, (*it)->freq);
+    hash_val(h, (*it)->bi);
+    hash_bytes(h, (*it)->fullID.data(), (*it)->fullID.size() + 1);
+  }
+  return h;
+};
+
+string
+Graph_Cache::get_filename(const string & dir, uint64_t key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.ftgc", (unsigned long long) key);
+  return dir + "/" + name;
+};
+
+Graph_Cache *
+Graph_Cache::open(const string & filename, uint64_t key) {
+  Graph_Cache * gc = 0;
+
+#ifndef _WIN32
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  if (fstat(fd, & st) < 0 || ! S_ISREG(st.st_mode) || st.st_size < (off_t) sizeof(File_Header)) {
+    ::close(fd);
+    return 0;
+  }
+  void * base = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED)
+    return 0;
+  gc = new Graph_Cache((const char *) base, st.st_size, true);
+#else
+  FILE * f = fopen(filename.c_str(), "rb");
+  if (! f)
+    return 0;
+  fseek(f, 0, SEEK_END);
+  long n = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (n < (long) sizeof(File_Header)) {
+    fclose(f);
+    return 0;
+  }
+  uint64_t * buf = new uint64_t[padded(n) / 8];
+  bool ok = fread(buf, 1, n, f) == (size_t) n;
+  fclose(f);
+  gc = new Graph_Cache((const char *) buf, n, false);
+  if (! ok) {
+    delete gc;
+    return 0;
+  }
+#endif
+
+  if (! gc->check(key)) {
+    std::cerr << "Warning: ignoring invalid graph cache file " << filename << std::endl;
+    delete gc;
+    return 0;
+  }
+  return gc;
+};
+
+bool
+Graph_Cache::check(uint64_t key) {
+  // make sure the header is ours, that each graph's arrays lie
+  // within the file, and that the indices in them are in range, then
+  // build the directory
+
+  const File_Header * hdr = (const File_Header *) base;
+  if (memcmp(hdr->magic, MAGIC, sizeof(MAGIC)) || hdr->key != key || hdr->node_size != sizeof(DFA_Node))
+    return false;
+  size_t dir_end = sizeof(File_Header) + (size_t) hdr->num_graphs * sizeof(Graph_Entry);
+  if (dir_end > size)
+    return false;
+
+  const Graph_Entry * ge = (const Graph_Entry *) (base + sizeof(File_Header));
+  for (uint32_t i = 0; i < hdr->num_graphs; ++i, ++ge) {
+    struct {uint64_t off; size_t len;} parts[] = {
+      {ge->nodes_off, ge->num_nodes * sizeof(DFA_Node)},
+      {ge->lo_off, ge->num_edges * sizeof(Gap)},
+      {ge->hi_off, ge->num_edges * sizeof(Gap)},
+      {ge->to_off, ge->num_edges * sizeof(DFA_Node::Index)}
+    };
+    for (unsigned int j = 0; j < sizeof(parts) / sizeof(parts[0]); ++j)
+      if (parts[j].off % 8 != 0 || parts[j].off < dir_end || parts[j].off > size || parts[j].len > size - parts[j].off)
+        return false;
+    if (! check_graph(ge))
+      return false;
+    entries[std::make_pair(ge->nom_freq, ge->lid)] = ge;
+  }
+  return true;
+};
+
+bool
+Graph_Cache::check_graph(const Graph_Entry * ge) {
+  // DFA_Graph::next() and the run finder follow these indices without
+  // checking them, so a corrupt or stale file must be rejected here
+
+  const DFA_Node * nodes = (const DFA_Node *) (base + ge->nodes_off);
+  for (uint32_t k = 0; k < ge->num_nodes; ++k) {
+    const DFA_Node & n = nodes[k];
+    if (n.first_edge > ge->num_edges || n.num_edges > ge->num_edges - n.first_edge
+        || n.first_tag > ge->num_tags || n.num_tags > ge->num_tags - n.first_tag)
+      return false;
+  }
+  const DFA_Node::Index * to = (const DFA_Node::Index *) (base + ge->to_off);
+  for (uint32_t k = 0; k < ge->num_edges; ++k)
+    if (to[k] >= ge->num_nodes)
+      return false;
+  return true;
+};
+
+bool
+Graph_Cache::attach(Nominal_Frequency_kHz nom_freq, Lotek_Tag_ID lid, DFA_Graph & g) {
+  auto ie = entries.find(std::make_pair(nom_freq, lid));
+  if (ie == entries.end() || ie->second->num_tags != g.tags.size() || ie->second->num_nodes == 0)
+    return false;
+  const Graph_Entry * ge = ie->second;
+
+  g.tag_list.assign(g.tags.begin(), g.tags.end());
+  g.ambiguous = ge->ambiguous != 0;
+  g.node_base = (DFA_Node *) (base + ge->nodes_off);
+  g.node_count = ge->num_nodes;
+  g.lo_base = (const Gap *) (base + ge->lo_off);
+  g.hi_base = (const Gap *) (base + ge->hi_off);
+  g.to_base = (const DFA_Node::Index *) (base + ge->to_off);
+  std::vector < Node_Map > ().swap(g.N);
+  return true;
+};
+
+uint64_t
+Graph_Cache::lay_out(uint64_t key, const std::vector < Run_Finder * > & rfs, std::function < void (const void *, size_t) > put) {
+
+  // lay out the directory, then the arrays after it
+
+  std::vector < Graph_Entry > dir;
+  std::vector < DFA_Graph * > graphs;
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir) {
+    for (auto ig = (*ir)->G.begin(); ig != (*ir)->G.end(); ++ig) {
+      DFA_Graph & g = ig->second;
+      Graph_Entry ge = {(*ir)->nom_freq, ig->first, (uint32_t) g.tag_list.size(), g.ambiguous,
+                        g.node_count, (uint32_t) g.edge_lo.size(), 0, 0, 0, 0};
+      dir.push_back(ge);
+      graphs.push_back(& g);
+    }
+  }
+  uint64_t off = padded(sizeof(File_Header) + dir.size() * sizeof(Graph_Entry));
+  for (auto id = dir.begin(); id != dir.end(); ++id) {
+    id->nodes_off = off;
+    off += padded(id->num_nodes * sizeof(DFA_Node));
+    id->lo_off = off;
+    off += padded(id->num_edges * sizeof(Gap));
+    id->hi_off = off;
+    off += padded(id->num_edges * sizeof(Gap));
+    id->to_off = off;
+    off += padded(id->num_edges * sizeof(DFA_Node::Index));
+  }
+  if (! put)
+    return off;
+
+  File_Header hdr;
+  memset(& hdr, 0, sizeof(hdr));
+  memcpy(hdr.magic, MAGIC, sizeof(MAGIC));
+  hdr.key = key;
+  hdr.num_graphs = dir.size();
+  hdr.node_size = sizeof(DFA_Node);
+  put(& hdr, sizeof(hdr));
+  put(dir.data(), dir.size() * sizeof(Graph_Entry));
+  for (size_t i = 0; i < graphs.size(); ++i) {
+    DFA_Graph & g = * graphs[i];
+    put(g.node_base, dir[i].num_nodes * sizeof(DFA_Node));
+    put(g.lo_base, dir[i].num_edges * sizeof(Gap));
+    put(g.hi_base, dir[i].num_edges * sizeof(Gap));
+    put(g.to_base, dir[i].num_edges * sizeof(DFA_Node::Index));
+  }
+  return off;
+};
+
+Graph_Cache *
+Graph_Cache::build(uint64_t key, const std::vector < Run_Finder * > & rfs) {
+
+  // the same layout as a file, but in memory, so that attach() works
+  // just as it does for a mapped file
+
+  size_t n = lay_out(key, rfs, 0);
+  uint64_t * buf = new uint64_t[n / 8];
+  char * p = (char *) buf;
+  lay_out(key, rfs, [&](const void * src, size_t len) {
+      if (len > 0)
+        memcpy(p, src, len);
+      memset(p + len, 0, padded(len) - len);
+      p += padded(len);
+    });
+  Graph_Cache * gc = new Graph_Cache((const char *) buf, n, false);
+  if (! gc->check(key)) {
+    delete gc;
+    throw std::runtime_error("Internal error: graphs laid out in memory are not valid");
+  }
+  return gc;
+};
+
+void
+Graph_Cache::write(const string & filename, uint64_t key, const std::vector < Run_Finder * > & rfs) {
+
+  // several runs may be filling the same cache, so each writes its
+  // own temporary file and renames it into place
+
+  char suffix[32];
+#ifndef _WIN32
+  snprintf(suffix, sizeof(suffix), ".%d.tmp", (int) getpid());
+#else
+  snprintf(suffix, sizeof(suffix), ".%d.tmp", (int) _getpid());
+#endif
+  string tmp = filename + suffix;
+  FILE * f = fopen(tmp.c_str(), "wb");
+  if (! f) {
+    std::cerr << "Warning: couldn't create graph cache file " << tmp << std::endl;
+    return;
+  }
+
+  static const char zeroes[8] = {0};
+  bool ok = true;
+  lay_out(key, rfs, [&](const void * p, size_t n) {
+      if (ok && n > 0)
+        ok = fwrite(p, 1, n, f) == n;
+      if (ok && padded(n) > n)
+        ok = fwrite(zeroes, 1, padded(n) - n, f) == padded(n) - n;
+    });
+  if (fclose(f) != 0)
+    ok = false;
+
+#ifdef _WIN32
+  if (ok)
+    remove(filename.c_str());
+#endif
+  if (! ok || rename(tmp.c_str(), filename.c_str()) != 0) {
+    std::cerr << "Warning: couldn't write graph cache file " << filename << std::endl;
+    remove(tmp.c_str());
+  }
+};
@@ -0,0 +1,119 @@
+#ifndef GRAPH_CACHE_HPP
+#define GRAPH_CACHE_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "DFA_Graph.hpp"
+#include "Tag_Database.hpp"
+#include "Run_Params.hpp"
+
+#include <vector>
+#include <map>
+#include <functional>
+#include <stdint.h>
+
+class Run_Finder;
+
+class Graph_Cache {
+
+  // Compiled DFA_Graphs saved in a file, so that a later run with the
+  // same tags and parameters can map them into memory instead of
+  // building them again.  The file is named for a hash of everything
+  // graphs are built from (see get_key()), so a cache directory can
+  // hold files for many tag databases and parameter settings.
+  //
+  // A file holds a header, a directory entry for each graph, and each
+  // graph's nodes and edge arrays exactly as DFA_Graph walks them.
+  // Everything is located by offset from the start of the file, so
+  // the file can be mapped anywhere.  It is in native byte order,
+  // and only meant to be read by the build that wrote it.
+
+protected:
+  struct File_Header {
+    char     magic[8];
+    uint64_t key;
+    uint32_t num_graphs;
+    uint32_t node_size;       // sizeof(DFA_Node)
+  };
+
+  struct Graph_Entry {
+    int32_t  nom_freq;
+    float    lid;
+    uint32_t num_tags;
+    uint32_t ambiguous;
+    uint32_t num_nodes;
+    uint32_t num_edges;
+    uint64_t nodes_off;
+    uint64_t lo_off;
+    uint64_t hi_off;
+    uint64_t to_off;
+  };
+
+  static const char MAGIC[8];
+
+  const char * base;   // the file's contents
+  size_t size;
+  bool mapped;         // is base mapped (rather than allocated)?
+  bool quiet;          // don't warn about ambiguous graphs as they are attached
+
+  std::map < std::pair < Nominal_Frequency_kHz, Lotek_Tag_ID >, const Graph_Entry * > entries;
+
+  Graph_Cache(const char * base, size_t size, bool mapped);
+
+  bool check(uint64_t key);
+
+  // are the indices in the nodes and edges of the graph for ge, whose
+  // arrays lie within the file, all within range?
+
+  bool check_graph(const Graph_Entry * ge);
+
+  // lay out the compiled graphs of run finders rfs as in a file,
+  // handing each piece to put, which must pad it to a multiple of 8
+  // bytes; returns the total size.  If put is empty, only the size is
+  // found.
+
+  static uint64_t lay_out(uint64_t key, const std::vector < Run_Finder * > & rfs, std::function < void (const void *, size_t) > put);
+
+public:
+
+  ~Graph_Cache();
+
+  // the hash identifying graphs built from tags with parameters params
+
+  static uint64_t get_key(Tag_Database * tags, const Run_Params & params);
+
+  // the name of the file in directory dir for key
+
+  static string get_filename(const string & dir, uint64_t key);
+
+  // open the cache in filename, returning 0 if there is none, or if
+  // it is not a valid cache for key
+
+  static Graph_Cache * open(const string & filename, uint64_t key);
+
+  // a cache in memory, holding the compiled graphs of run finders rfs,
+  // so that other run finders can share them rather than building
+  // their own (see Receiver_Batch).  rfs can then be destroyed.
+
+  static Graph_Cache * build(uint64_t key, const std::vector < Run_Finder * > & rfs);
+
+  // don't warn about ambiguous graphs as they are attached, e.g.
+  // because that was done when the graphs were first built
+
+  void set_quiet(bool quiet) {this->quiet = quiet;};
+
+  bool is_quiet() {return quiet;};
+
+  // make g, the graph for lid at nom_freq, into the one in the cache;
+  // returns false if it isn't there
+
+  bool attach(Nominal_Frequency_kHz nom_freq, Lotek_Tag_ID lid, DFA_Graph & g);
+
+  // save the compiled graphs of run finders rfs in filename.  This
+  // only warns on failure, as the cache is not needed for correct
+  // results.
+
+  static void write(const string & filename, uint64_t key, const std::vector < Run_Finder * > & rfs);
+};
+
+#endif // GRAPH_CACHE_HPP
@@ -5,6 +5,8 @@
 #include <string>
 #include <vector>
 #include <unordered_map>
+#include <atomic>
+#include <mutex>
 
 class Hashed_String_Vector;
 
@@ -15,49 +17,97 @@ class Hashed_String_Vector;
 class Hashed_String_Vector {
 
   // wasteful, as we maintain two copies of each string,
-  // one for the hash and one for the vector.
+  // one for the hash and one for the blocks.
 
 private:
-  int count;
-  std::vector < std::string > strings;
+  // strings live in blocks which never move once allocated, block k
+  // holding 2^k of them, so that while one thread adds strings, others
+  // can read those already added (e.g. antenna codes of hits being
+  // filtered while later hits are read).  Lookups by string, and
+  // additions, hold lock, so that several threads can add strings
+  // (e.g. antenna codes while reading several inputs at once).
+
+  static const int NUM_BLOCKS = 31;
+  std::string * blocks[NUM_BLOCKS];
+  std::atomic < int > count;
   typedef std::unordered_map < std::string, int > mymap;
   mymap indexes;
+  std::mutex lock;
+
+  // string index is at position index + 1 - 2^k of block k
+
+  static int block_of(int index) {
+    int k = 0;
+    while ((2U << k) <= (unsigned int) index + 1)
+      ++k;
+    return k;
+  };
+
+  std::string & at(int index) {
+    int k = block_of(index);
+    return blocks[k][index + 1 - (1U << k)];
+  };
+
+  Hashed_String_Vector(const Hashed_String_Vector &);
+  Hashed_String_Vector & operator= (const Hashed_String_Vector &);
 
 public:
 
   Hashed_String_Vector() :
     count(0),
-    strings(),
-    indexes()
+    indexes(),
+    lock()
   {
+    for (int k = 0; k < NUM_BLOCKS; ++k)
+      blocks[k] = 0;
+  };
+
+  ~Hashed_String_Vector() {
+    for (int k = 0; k < NUM_BLOCKS; ++k)
+      delete [] blocks[k];
   };
 
   // read-only indexing behaves as expected
-  int const operator[] (std::string string) {
-    if (indexes.count(string))
-      return indexes[string];
+  int const operator[] (const std::string & string) {
+    std::lock_guard < std::mutex > guard(lock);
+    auto i = indexes.find(string);
+    if (i != indexes.end())
+      return i->second;
     else
       return -1;
   };
 
   std::string operator[] (int index) {
-    if (index < (int) strings.size() && index >= 0)
-      return strings[index];
+    if (index < count.load(std::memory_order_acquire) && index >= 0)
+      return at(index);
     else
       return 0;
   };
 
+  int size () const {
+    return count.load(std::memory_order_acquire);
+  };
+
   bool has (std::string &string) {
+    std::lock_guard < std::mutex > guard(lock);
     return indexes.count(string) > 0;
   };
 
-  int add (std::string string) {
-    if (indexes.count(string))
-      return indexes[string];
-
-    strings.push_back(string);
-    indexes.insert(std::pair < std::string, int > (string, count));
-    return count++;
+  int add (const std::string & string) {
+    std::lock_guard < std::mutex > guard(lock);
+    auto i = indexes.find(string);
+    if (i != indexes.end())
+      return i->second;
+
+    // only a thread holding lock changes count, so it can be read plainly here
+    int n = count.load(std::memory_order_relaxed);
+    int k = block_of(n);
+    if (! blocks[k])
+      blocks[k] = new std::string[1U << k];
+    at(n) = string;
+    indexes.insert(std::pair < std::string, int > (string, n));
+    count.store(n + 1, std::memory_order_release);
+    return n;
   };
 };
 
@@ -1,5 +1,4 @@
 #include "Hit.hpp"
-#include "Run_Foray.hpp"
 
 Hit::Hit(double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float lon, unsigned int dtaline, Frequency_MHz ant_freq, short gain, int codeset_id) :
   ts(ts),
@@ -13,16 +12,15 @@ Hit::Hit(double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float
   gain(gain),
   codeset_id(codeset_id)
 { 
-  static Seq_No seq_no = 0;
-
-  this->seq_no = ++seq_no;
 };
 
-Hit Hit::make(double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float lon, unsigned int dtaline, Frequency_MHz ant_freq, short gain, int codeset_id) {
-  return Hit(ts, lid, ant_code, sig, lat, lon, dtaline, ant_freq, gain, codeset_id);
+Hit Hit::make(Hit_Codes * codes, double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float lon, unsigned int dtaline, Frequency_MHz ant_freq, short gain, int codeset_id) {
+  Hit h(ts, lid, ant_code, sig, lat, lon, dtaline, ant_freq, gain, codeset_id);
+  h.seq_no = ++ codes->last_seq_no;
+  return h;
 };
 
-void Hit::dump() {
+void Hit::dump(Hit_Codes * codes) {
   // 14 digits in timestamp output yields 0.1 ms precision
-  std::cout << std::setprecision(14) << ts << std::setprecision(3) << ',' << lid << ',' << Run_Foray::ant_codes[ant_code] << sig << endl;
+  std::cout << std::setprecision(14) << ts << std::setprecision(3) << ',' << lid << ',' << codes->ant_codes[ant_code] << sig << endl;
 };
@@ -2,9 +2,12 @@
 #define HIT_HPP
 
 #include "filter_tags_common.hpp"
+#include "Hashed_String_Vector.hpp"
 
 #include <map>
 
+class Hit_Codes;
+
 struct Hit {
 
   // a tag detection from the lotek receiver, as reported by the R function readDTA()
@@ -36,9 +39,27 @@ private:
 public:
   Hit(){};
 
-  static Hit make(double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float lon, unsigned int dtaline, Frequency_MHz ant_freq, short gain, int codeset_id);
+  // a new hit, numbered after the last one made with codes
+
+  static Hit make(Hit_Codes * codes, double ts, Lotek_Tag_ID lid, int ant_code, short sig, float lat, float lon, unsigned int dtaline, Frequency_MHz ant_freq, short gain, int codeset_id);
+
+  void dump(Hit_Codes * codes);
+};
+
+class Hit_Codes {
+
+  // the labels which hits' ant_code and codeset_id index, and the
+  // sequence number of the most recently made hit.  Each Run_Foray
+  // has its own, shared with its Hit_Source and Output_Sink, so that
+  // several forays can find runs in separate inputs at once (see
+  // Receiver_Batch and libfilter_tags.h).
+
+public:
+  Hashed_String_Vector ant_codes;
+  Hashed_String_Vector codeset_ids;
+  Hit::Seq_No last_seq_no;
 
-  void dump();
+  Hit_Codes() : ant_codes(), codeset_ids(), last_seq_no(0) {};
 };
 
 typedef std::map < Hit::Seq_No, Hit > Hit_Buffer;
@@ -0,0 +1,36 @@
+#ifndef HIT_SOURCE_HPP
+#define HIT_SOURCE_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit.hpp"
+
+class Hit_Source {
+
+  // a stream of tag hits, in the order they are to be processed
+
+protected:
+  Hit_Codes * codes; // labels and numbering for the hits made
+
+public:
+
+  Hit_Source() : codes(0) {};
+
+  virtual ~Hit_Source() {};
+
+  // number hits, and code their labels, with codes; this must be set
+  // before next() is called (Run_Foray sets it to its own)
+
+  void set_codes(Hit_Codes * codes) {this->codes = codes;};
+
+  // get the next valid hit; returns false at end of input
+
+  virtual bool next(Hit &h) = 0;
+
+  // after next() has returned false, has input really ended, rather
+  // than just having nothing more for now (when streaming)?
+
+  virtual bool at_end() {return true;};
+};
+
+#endif // HIT_SOURCE_HPP
@@ -1,26 +1,41 @@
 #include "Known_Tag.hpp"
 
-#include <sstream>
+#include <stdio.h>
 #include <math.h>
+#include <mutex>
 
-Known_Tag::Known_Tag(Lotek_Tag_ID lid, string proj, Nominal_Frequency_kHz freq, float bi) :
+Known_Tag::Known_Tag(Lotek_Tag_ID lid, const string * proj, Nominal_Frequency_kHz freq, float bi) :
   lid(lid),
   proj(proj),
   freq(freq),
   bi(bi)
 {
   // generate a full ID string  Proj#Lid@NOMFREQ:BI
-  std::ostringstream fid;
-  fid << proj << '#' << std::setprecision(4) << lid << '@' << std::setprecision(6) << freq / 1000.0 << ':' << round(10 * bi) / 10;
-  fullID = fid.str();
-  if (all_fullIDs.count(fullID)) {
-    std::cerr << "Warning - two very similar tags in project " << proj << ":\nLotek ID: " << lid << "; frequency: " << (freq / 1000.0) << " MHz; burst interval: " << round(10 * bi) / 10 << " sec\nAppending '!' to fullID of second one.\n";
-    while (all_fullIDs.count(fullID)) {
+  // The formats are those an ostream would use with precisions 4, 6 and 6.
+  char fid[MAX_LINE_SIZE + 64];
+  snprintf(fid, sizeof(fid), "%s#%.4g@%.6g:%.6g", proj->c_str(), (double) lid, freq / 1000.0, (double) (round(10 * bi) / 10));
+  fullID = fid;
+};
+
+void
+Known_Tag::make_unique(std::unordered_set < std::string > & full_ids) {
+  if (full_ids.count(fullID)) {
+    std::cerr << "Warning - two very similar tags in project " << *proj << ":\nLotek ID: " << lid << "; frequency: " << (freq / 1000.0) << " MHz; burst interval: " << round(10 * bi) / 10 << " sec\nAppending '!' to fullID of second one.\n";
+    while (full_ids.count(fullID)) {
       fullID += '!';
     };
   }
-  all_fullIDs.insert(fullID);
+  full_ids.insert(fullID);
+};
+
+const string *
+Known_Tag::intern_proj(const string & proj) {
+  std::lock_guard < std::mutex > guard(projs_lock);
+  return & * all_projs.insert(proj).first;
 };
 
 std::unordered_set < std::string >
-Known_Tag::all_fullIDs;       // will be populated as tags database is built
+Known_Tag::all_projs;
+
+std::mutex
+Known_Tag::projs_lock;
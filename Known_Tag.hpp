@@ -5,6 +5,7 @@
 
 #include <unordered_map>
 #include <unordered_set>
+#include <mutex>
 
 struct Known_Tag {
 
@@ -14,20 +15,30 @@ struct Known_Tag {
 public:
 
   Lotek_Tag_ID		lid;				// lotek ID
-  std::string		proj;				// project name
+  const std::string *	proj;				// project name, interned
   Nominal_Frequency_kHz freq;				// nominal transmit frequency
   float			bi;	                        // burst interval, in seconds
 
   std::string           fullID;                         // full ID, used when printing tags
 
 private:
-  static std::unordered_set < std::string > all_fullIDs;       // full ID list
+  static std::unordered_set < std::string > all_projs;         // interned project names
+  static std::mutex projs_lock;                                // held while interning, as several tag databases may be loaded at once
 
 public:
 
   Known_Tag(){};
 
-  Known_Tag(Lotek_Tag_ID lid, std::string proj, Nominal_Frequency_kHz freq, float bi);
+  Known_Tag(Lotek_Tag_ID lid, const std::string * proj, Nominal_Frequency_kHz freq, float bi);
+
+  // if fullID is already in full_ids (those of other tags in the same
+  // database), warn, and append '!' until it isn't; then add it there
+
+  void make_unique(std::unordered_set < std::string > & full_ids);
+
+  // return the single stored copy of project name proj
+
+  static const std::string * intern_proj(const std::string & proj);
 };
 
 typedef std::unordered_set < Known_Tag * > Tag_Set; 
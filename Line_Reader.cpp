@@ -0,0 +1,246 @@
+#include "Line_Reader.hpp"
+
+#include <string.h>
+#include <errno.h>
+#include <chrono>
+#include <thread>
+#include <sys/stat.h>
+#include <fcntl.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <unistd.h>
+#include <poll.h>
+#else
+#include <io.h>
+#endif
+
+// Newlines are found with memchr, which the C library already
+// implements with vector instructions on the platforms we build for.
+
+Line_Reader::~Line_Reader() {
+};
+
+bool
+Line_Reader::at_end() {
+  return true;
+};
+
+Line_Reader *
+Line_Reader::open(const string & filename) {
+  Line_Reader * r = Mapped_Line_Reader::map(filename);
+  if (r)
+    return r;
+  std::unique_ptr < std::istream > in(new ifstream(filename.c_str(), ifstream::in | ifstream::binary));
+  if (in->fail())
+    throw std::runtime_error(string("Couldn't open input file ") + filename);
+  return new Block_Line_Reader(std::move(in));
+};
+
+Block_Line_Reader::Block_Line_Reader(std::istream * in) :
+  owned(),
+  in(in),
+  buf(BLOCK_SIZE),
+  begin(0),
+  end(0),
+  eof(false)
+{
+};
+
+Block_Line_Reader::Block_Line_Reader(std::unique_ptr < std::istream > in) :
+  owned(std::move(in)),
+  in(owned.get()),
+  buf(BLOCK_SIZE),
+  begin(0),
+  end(0),
+  eof(false)
+{
+};
+
+bool
+Block_Line_Reader::next_line(const char * & line, size_t & len) {
+  for (;;) {
+    const char * p = & buf[begin];
+    const char * nl = (const char *) memchr(p, '\n', end - begin);
+    if (nl) {
+      line = p;
+      len = nl - p;
+      begin += len + 1;
+      return true;
+    }
+    if (eof) {
+      // final line, without a newline
+      if (begin == end)
+        return false;
+      line = p;
+      len = end - begin;
+      begin = end;
+      return true;
+    }
+    // move the partial line to the start of the buffer, growing it
+    // if a single line fills the whole thing, then read more
+
+    if (begin > 0) {
+      memmove(& buf[0], p, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+    if (end == buf.size())
+      buf.resize(2 * buf.size());
+    in->read(& buf[end], buf.size() - end);
+    end += in->gcount();
+    if (! *in)
+      eof = true;
+  }
+};
+
+#ifndef _WIN32
+
+Mapped_Line_Reader *
+Mapped_Line_Reader::map(const string & filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return 0;
+  struct stat st;
+  if (fstat(fd, & st) < 0 || ! S_ISREG(st.st_mode) || st.st_size == 0) {
+    ::close(fd);
+    return 0;
+  }
+  void * base = mmap(0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED)
+    return 0;
+  madvise(base, st.st_size, MADV_SEQUENTIAL);
+  return new Mapped_Line_Reader((const char *) base, st.st_size);
+};
+
+Mapped_Line_Reader::~Mapped_Line_Reader() {
+  munmap((void *) base, size);
+};
+
+#else
+
+Mapped_Line_Reader *
+Mapped_Line_Reader::map(const string & filename) {
+  return 0;
+};
+
+Mapped_Line_Reader::~Mapped_Line_Reader() {
+};
+
+#endif
+
+Mapped_Line_Reader::Mapped_Line_Reader(const char * base, size_t size) :
+  base(base),
+  size(size),
+  pos(0)
+{
+};
+
+bool
+Mapped_Line_Reader::next_line(const char * & line, size_t & len) {
+  if (pos >= size)
+    return false;
+  line = base + pos;
+  const char * nl = (const char *) memchr(line, '\n', size - pos);
+  len = nl ? nl - line : size - pos;
+  pos += len + 1;
+  return true;
+};
+
+Follow_Line_Reader::Follow_Line_Reader(int fd, double timeout) :
+  fd(fd),
+  follow(false),
+  timeout(timeout),
+  buf(BLOCK_SIZE),
+  begin(0),
+  end(0),
+  eof(false)
+{
+  struct stat st;
+  follow = fstat(fd, & st) == 0 && S_ISREG(st.st_mode);
+};
+
+Follow_Line_Reader *
+Follow_Line_Reader::open(const string & filename, double timeout) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    throw std::runtime_error(string("Couldn't open input file ") + filename);
+  return new Follow_Line_Reader(fd, timeout);
+};
+
+Follow_Line_Reader::~Follow_Line_Reader() {
+  if (fd != 0)
+    ::close(fd);
+};
+
+bool
+Follow_Line_Reader::next_line(const char * & line, size_t & len) {
+  auto deadline = std::chrono::steady_clock::now() + std::chrono::duration < double > (timeout);
+  for (;;) {
+    const char * p = & buf[begin];
+    const char * nl = (const char *) memchr(p, '\n', end - begin);
+    if (nl) {
+      line = p;
+      len = nl - p;
+      begin += len + 1;
+      return true;
+    }
+    if (eof) {
+      // final line, without a newline
+      if (begin == end)
+        return false;
+      line = p;
+      len = end - begin;
+      begin = end;
+      return true;
+    }
+    if (begin > 0) {
+      memmove(& buf[0], p, end - begin);
+      end -= begin;
+      begin = 0;
+    }
+    if (end == buf.size())
+      buf.resize(2 * buf.size());
+
+    double left = std::chrono::duration < double > (deadline - std::chrono::steady_clock::now()).count();
+
+#ifndef _WIN32
+    // a regular file always polls as readable, so only wait here on
+    // anything else
+
+    if (! follow) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      int rv = poll(& pfd, 1, left > 0 ? (int) (left * 1000) : 0);
+      if (rv == 0 || (rv < 0 && errno == EINTR))
+        return false;
+      if (rv < 0)
+        throw std::runtime_error(string("Error waiting for input: ") + strerror(errno));
+    }
+#endif
+    long n = ::read(fd, & buf[end], buf.size() - end);
+    if (n > 0) {
+      end += n;
+    } else if (n == 0) {
+      if (! follow) {
+        eof = true;
+      } else {
+        if (left <= 0)
+          return false;
+        double wait = FOLLOW_INTERVAL;
+        if (left < wait)
+          wait = left;
+        std::this_thread::sleep_for(std::chrono::duration < double > (wait));
+      }
+    } else if (errno == EINTR) {
+      return false;
+    } else {
+      throw std::runtime_error(string("Error reading input: ") + strerror(errno));
+    }
+  }
+};
+
+bool
+Follow_Line_Reader::at_end() {
+  return eof && begin == end;
+};
@@ -0,0 +1,125 @@
+#ifndef LINE_READER_HPP
+#define LINE_READER_HPP
+
+#include "filter_tags_common.hpp"
+
+#include <vector>
+#include <memory>
+
+class Line_Reader {
+
+  // deliver the lines of a text input without copying them one at a
+  // time.  Each line is returned as a pointer and length, without
+  // its terminating newline, and remains valid only until the next
+  // call.
+
+public:
+
+  virtual ~Line_Reader();
+
+  // get the next line; returns false at end of input
+
+  virtual bool next_line(const char * & line, size_t & len) = 0;
+
+  // after next_line() has returned false, has input really ended?
+  // Only a Follow_Line_Reader returns false here, meaning that no
+  // line arrived in time, but more might later.
+
+  virtual bool at_end();
+
+  // return a reader for the named file, mapped into memory where
+  // possible; throws if the file can't be opened
+
+  static Line_Reader * open(const string & filename);
+};
+
+class Block_Line_Reader : public Line_Reader {
+
+  // read lines from a stream in large blocks; used for stdin and
+  // where memory mapping is not available
+
+protected:
+  static const size_t BLOCK_SIZE = 1 << 20;
+
+  std::unique_ptr < std::istream > owned; // in, if this reader owns it
+  std::istream * in;
+  std::vector < char > buf;
+  size_t begin;   // start of unread data in buf
+  size_t end;     // end of valid data in buf
+  bool eof;
+
+public:
+
+  // read from in, which the caller keeps (e.g. std::cin)
+
+  Block_Line_Reader(std::istream * in);
+
+  // read from in, which is deleted along with this reader
+
+  Block_Line_Reader(std::unique_ptr < std::istream > in);
+
+  bool next_line(const char * & line, size_t & len);
+};
+
+class Mapped_Line_Reader : public Line_Reader {
+
+  // read lines from a file mapped into memory
+
+protected:
+  const char * base;
+  size_t size;
+  size_t pos;
+
+public:
+
+  // returns 0 if the file can't be mapped
+
+  static Mapped_Line_Reader * map(const string & filename);
+
+  ~Mapped_Line_Reader();
+
+  bool next_line(const char * & line, size_t & len);
+
+protected:
+  Mapped_Line_Reader(const char * base, size_t size);
+};
+
+class Follow_Line_Reader : public Line_Reader {
+
+  // read lines from a file descriptor as they are written, for
+  // streaming.  next_line() returns false if no complete line arrives
+  // within the timeout.  A regular file is followed as it grows, and
+  // so never ends; anything else (e.g. a pipe) ends when its writer
+  // closes it.  A partial line is held until its newline arrives.
+  // A signal received while waiting counts as a timeout.
+
+protected:
+  static const size_t BLOCK_SIZE = 1 << 16;
+  static constexpr double FOLLOW_INTERVAL = 0.1; // seconds between looks at a file with no new data
+
+  int fd;
+  bool follow;    // is fd a regular file?
+  double timeout; // seconds
+  std::vector < char > buf;
+  size_t begin;   // start of unread data in buf
+  size_t end;     // end of valid data in buf
+  bool eof;
+
+public:
+
+  // read from fd, which is closed on destruction unless it is 0 (stdin)
+
+  Follow_Line_Reader(int fd, double timeout);
+
+  // throws if the file can't be opened
+
+  static Follow_Line_Reader * open(const string & filename, double timeout);
+
+  ~Follow_Line_Reader();
+
+  bool next_line(const char * & line, size_t & len);
+
+  bool at_end();
+};
+
+#endif // LINE_READER_HPP
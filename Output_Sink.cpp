@@ -0,0 +1,190 @@
+#include "Output_Sink.hpp"
+
+#include <cstring>
+#include <cstdio>
+
+Output_Sink::Output_Sink() :
+  run_id_counter(0),
+  codes(0)
+{
+};
+
+Output_Sink::~Output_Sink() {
+};
+
+unsigned long long
+Output_Sink::new_run_id(const Hit &h) {
+  return ++run_id_counter;
+};
+
+unsigned long long
+Output_Sink::get_last_run_id() {
+  return run_id_counter;
+};
+
+void
+Output_Sink::set_last_run_id(unsigned long long run_id) {
+  run_id_counter = run_id;
+};
+
+void
+Output_Sink::set_codes(Hit_Codes * codes) {
+  this->codes = codes;
+};
+
+void
+Output_Sink::end_run(unsigned long long run_id) {
+};
+
+void
+Output_Sink::flush() {
+};
+
+Stream_Sink::Stream_Sink(ostream *os) :
+  os(os)
+{
+};
+
+void
+Stream_Sink::put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+  (*os) << prefix
+        << std::setprecision(14)
+        << h.ts
+        << std::setprecision(4)
+        << ',' << codes->ant_codes[h.ant_code]
+        << ',' << tag->fullID
+        << ',' << run_id
+        << ',' << pos_in_run
+        << ',' << h.sig
+        << ',' << burst_slop
+        << ',' << h.dtaline
+        << std::setprecision(9)
+        << ',' << h.lat
+        << ',' << h.lon
+        << std::setprecision(6)
+        << ',' << h.ant_freq
+        << std::setprecision(4)
+        << ',' << h.gain
+        << std::endl;
+};
+
+void
+Stream_Sink::flush() {
+  os->flush();
+};
+
+Buffered_CSV_Sink::Buffered_CSV_Sink(ostream *os) :
+  os(os),
+  buf(2 * FLUSH_BYTES),
+  used(0),
+  puts_since_check(0),
+  last_flush(std::chrono::steady_clock::now())
+{
+};
+
+Buffered_CSV_Sink::~Buffered_CSV_Sink() {
+  flush();
+};
+
+char *
+Buffered_CSV_Sink::reserve(size_t n) {
+  // make room for n more bytes at the end of the buffer
+
+  if (used + n > buf.size())
+    buf.resize(2 * (used + n));
+  return & buf[used];
+};
+
+void
+Buffered_CSV_Sink::add(const string &s) {
+  memcpy(reserve(s.size()), s.data(), s.size());
+  used += s.size();
+};
+
+void
+Buffered_CSV_Sink::add(char c) {
+  * reserve(1) = c;
+  ++used;
+};
+
+void
+Buffered_CSV_Sink::add(unsigned long long x) {
+  // digits are generated backwards into a scratch area, then copied
+
+  char tmp[24];
+  char * p = tmp + sizeof(tmp);
+  do {
+    * --p = '0' + x % 10;
+    x /= 10;
+  } while (x);
+  size_t n = tmp + sizeof(tmp) - p;
+  memcpy(reserve(n), p, n);
+  used += n;
+};
+
+void
+Buffered_CSV_Sink::add(long long x) {
+  if (x < 0) {
+    add('-');
+    add(0ULL - (unsigned long long) x);
+  } else {
+    add((unsigned long long) x);
+  }
+};
+
+void
+Buffered_CSV_Sink::add(double x, int precision) {
+  // ostream's default floatfield formatting with precision p is
+  // printf's "%.pg", so this matches Stream_Sink exactly.
+
+  char * p = reserve(32);
+  used += snprintf(p, 32, "%.*g", precision, x);
+};
+
+void
+Buffered_CSV_Sink::put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+  add(prefix);
+  add(h.ts, 14);
+  add(',');
+  add(codes->ant_codes[h.ant_code]);
+  add(',');
+  add(tag->fullID);
+  add(',');
+  add(run_id);
+  add(',');
+  add((unsigned long long) pos_in_run);
+  add(',');
+  add((long long) h.sig);
+  add(',');
+  add(burst_slop, 4);
+  add(',');
+  add((unsigned long long) h.dtaline);
+  add(',');
+  add(h.lat, 9);
+  add(',');
+  add(h.lon, 9);
+  add(',');
+  add(h.ant_freq, 6);
+  add(',');
+  add((long long) h.gain);
+  add('\n');
+
+  if (used >= FLUSH_BYTES) {
+    flush();
+  } else if (++puts_since_check == CLOCK_CHECK_EVERY) {
+    puts_since_check = 0;
+    if (std::chrono::duration < double > (std::chrono::steady_clock::now() - last_flush).count() >= MAX_FLUSH_DELAY)
+      flush();
+  }
+};
+
+void
+Buffered_CSV_Sink::flush() {
+  if (used > 0) {
+    os->write(& buf[0], used);
+    used = 0;
+  }
+  os->flush();
+  puts_since_check = 0;
+  last_flush = std::chrono::steady_clock::now();
+};
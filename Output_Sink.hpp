@@ -0,0 +1,110 @@
+#ifndef OUTPUT_SINK_HPP
+#define OUTPUT_SINK_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit.hpp"
+#include "Known_Tag.hpp"
+
+#include <vector>
+#include <chrono>
+
+class Output_Sink {
+
+  // destination for hits from confirmed runs.  The sink also hands
+  // out run IDs, so that these are numbered in the order in which
+  // run candidates were started, regardless of how the work of
+  // finding runs is divided up.
+
+protected:
+  unsigned long long run_id_counter; // last run ID handed out
+  Hit_Codes * codes;                 // labels of the hits put
+
+public:
+
+  Output_Sink();
+
+  virtual ~Output_Sink();
+
+  // return the ID for a new run candidate started by hit h
+
+  virtual unsigned long long new_run_id(const Hit &h);
+
+  // the last run ID handed out; setting it continues numbering after
+  // run_id, e.g. when resuming from a checkpoint
+
+  unsigned long long get_last_run_id();
+
+  void set_last_run_id(unsigned long long run_id);
+
+  // look up the labels of hits put with codes, which must be those
+  // the hits were made with (Run_Foray sets it to its own)
+
+  void set_codes(Hit_Codes * codes);
+
+  // output one hit from a confirmed run
+
+  virtual void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) = 0;
+
+  // note that no more hits will be put for run run_id
+
+  virtual void end_run(unsigned long long run_id);
+
+  // make sure everything put so far has reached its destination
+
+  virtual void flush();
+};
+
+class Stream_Sink : public Output_Sink {
+
+  // write hits as .CSV records to an ostream
+
+protected:
+  ostream * os;
+
+public:
+
+  Stream_Sink(ostream *os);
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop);
+
+  void flush();
+};
+
+class Buffered_CSV_Sink : public Output_Sink {
+
+  // write hits as .CSV records to an ostream, byte-for-byte the same
+  // as Stream_Sink, but formatted into a buffer which is only written
+  // out once it holds FLUSH_BYTES, or once MAX_FLUSH_DELAY seconds have
+  // passed since it was last written, rather than flushing every line.
+
+protected:
+  static const size_t FLUSH_BYTES = 1 << 16;
+  static const unsigned CLOCK_CHECK_EVERY = 64; // puts between looks at the clock
+  static constexpr double MAX_FLUSH_DELAY = 1.0;
+
+  ostream * os;
+  std::vector < char > buf;
+  size_t used;
+  unsigned puts_since_check;
+  std::chrono::steady_clock::time_point last_flush;
+
+  char * reserve(size_t n);
+  void add(const string &s);
+  void add(char c);
+  void add(unsigned long long x);
+  void add(long long x);
+  void add(double x, int precision);
+
+public:
+
+  Buffered_CSV_Sink(ostream *os);
+
+  ~Buffered_CSV_Sink();
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop);
+
+  void flush();
+};
+
+#endif // OUTPUT_SINK_HPP
@@ -0,0 +1,257 @@
+#include "Param_Sweep.hpp"
+
+#include "Run_Foray.hpp"
+#include "Work_Queue.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <set>
+#include <stdlib.h>
+
+namespace {
+
+  typedef std::shared_ptr < const std::vector < Hit > > Hit_Batch;
+
+  // hits from batches shared by all configurations
+
+  class Batch_Hit_Source : public Hit_Source {
+    Work_Queue < Hit_Batch > & in;
+    Hit_Batch cur;
+    size_t i;
+  public:
+    Batch_Hit_Source(Work_Queue < Hit_Batch > & in) : in(in), cur(), i(0) {};
+
+    bool next(Hit &h) {
+      while (! cur || i == cur->size()) {
+        if (! in.pop(cur))
+          return false;
+        i = 0;
+      }
+      h = (*cur)[i++];
+      return true;
+    };
+  };
+
+  // pass hits on to another sink, counting runs and hits
+
+  class Tally_Sink : public Output_Sink {
+    Output_Sink * out;
+  public:
+    unsigned long long runs;
+    unsigned long long hits;
+
+    Tally_Sink(Output_Sink * out) : out(out), runs(0), hits(0) {};
+
+    void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+      if (pos_in_run == 1)
+        ++runs;
+      ++hits;
+      out->put(prefix, h, tag, run_id, pos_in_run, burst_slop);
+    };
+
+    void end_run(unsigned long long run_id) {
+      out->end_run(run_id);
+    };
+
+    void flush() {
+      out->flush();
+    };
+  };
+
+  // one configuration's foray, and the thread it runs on
+
+  struct Lane {
+    Work_Queue < Hit_Batch > in;
+    Batch_Hit_Source source;
+    Tally_Sink sink;
+    Run_Foray foray;
+    std::thread thread;
+    string error;
+
+    Lane(Tag_Database * tags, Output_Sink * out, unsigned int capacity) :
+      in(capacity),
+      source(in),
+      sink(out),
+      foray(tags, & source, & sink),
+      error()
+    {
+    };
+
+    void run() {
+      try {
+        foray.start();
+      } catch (std::runtime_error & e) {
+        error = e.what();
+      }
+      // keep taking batches, so that the reader never waits on a
+      // configuration which has stopped
+      Hit h;
+      while (source.next(h))
+        ;
+    };
+  };
+
+  bool parse_field(const string & s, double & x) {
+    if (s.length() == 0)
+      return true;
+    char * end;
+    x = strtod(s.c_str(), & end);
+    return *end == '\0';
+  };
+
+  bool parse_field(const string & s, unsigned int & x) {
+    if (s.length() == 0)
+      return true;
+    char * end;
+    long n = strtol(s.c_str(), & end, 10);
+    if (*end != '\0' || n < 0)
+      return false;
+    x = n;
+    return true;
+  };
+};
+
+Param_Sweep::Param_Sweep(Tag_Database * tags, Hit_Source * data) :
+  tags(tags),
+  data(data),
+  codes(),
+  configs(),
+  sinks(),
+  graph_cache_dir(),
+  lazy_graphs(false)
+{
+};
+
+std::vector < Param_Sweep::Config >
+Param_Sweep::read_configs(const string & filename, const Run_Params & defaults) {
+  std::ifstream f(filename.c_str());
+  if (! f.good())
+    throw std::runtime_error(string("Couldn't open sweep file ") + filename);
+
+  std::vector < Config > configs;
+  std::set < string > names;
+  string line;
+  for (unsigned int line_no = 1; std::getline(f, line); ++line_no) {
+    if (line.length() > 0 && line[line.length() - 1] == '\r')
+      line.erase(line.length() - 1);
+    if (line.length() == 0 || line[0] == '#')
+      continue;
+
+    std::vector < string > fields;
+    std::istringstream ls(line);
+    string field;
+    while (std::getline(ls, field, ','))
+      fields.push_back(field);
+    if (line[line.length() - 1] == ',')
+      fields.push_back("");
+
+    Config c;
+    c.name = fields.size() > 0 ? fields[0] : "";
+    c.params = defaults;
+    double burst_slop_ms = defaults.burst_slop * 1000.0;
+    double burst_slop_expansion_ms = defaults.burst_slop_expansion * 1000.0;
+    if (fields.size() != 6 || c.name.length() == 0
+        || ! parse_field(fields[1], burst_slop_ms)
+        || ! parse_field(fields[2], burst_slop_expansion_ms)
+        || ! parse_field(fields[3], c.params.hits_to_confirm_id)
+        || ! parse_field(fields[4], c.params.max_skipped_bursts)
+        || ! parse_field(fields[5], c.params.timestamp_wonkiness)) {
+      std::ostringstream msg;
+      msg << "Line " << line_no << " of sweep file " << filename << " is not NAME,BSLOP,BSLOPEXP,CONFIRM,SKIPS,WONK";
+      throw std::runtime_error(msg.str());
+    }
+    if (! names.insert(c.name).second)
+      throw std::runtime_error(string("Sweep file ") + filename + " has more than one configuration named " + c.name);
+    c.params.set_burst_slop_ms(burst_slop_ms);
+    c.params.set_burst_slop_expansion_ms(burst_slop_expansion_ms);
+    configs.push_back(c);
+  }
+  if (configs.size() == 0)
+    throw std::runtime_error(string("Sweep file ") + filename + " has no configurations");
+  return configs;
+};
+
+void
+Param_Sweep::add_config(const Config & c, Output_Sink * sink) {
+  configs.push_back(c);
+  sinks.push_back(sink);
+};
+
+void
+Param_Sweep::set_graph_cache_dir(const string & dir) {
+  graph_cache_dir = dir;
+};
+
+void
+Param_Sweep::set_lazy_graphs(bool lazy_graphs) {
+  this->lazy_graphs = lazy_graphs;
+};
+
+void
+Param_Sweep::start(ostream * summary) {
+  data->set_codes(& codes);
+  std::vector < std::unique_ptr < Lane > > lanes;
+  for (unsigned int i = 0; i < configs.size(); ++i) {
+    Lane * l = new Lane(tags, sinks[i], MAX_BATCHES_IN_FLIGHT);
+    lanes.push_back(std::unique_ptr < Lane > (l));
+    sinks[i]->set_codes(& codes);
+    l->foray.set_codes(& codes);
+    l->foray.set_params(configs[i].params);
+    l->foray.set_graph_cache_dir(graph_cache_dir);
+    l->foray.set_lazy_graphs(lazy_graphs);
+  }
+  for (auto il = lanes.begin(); il != lanes.end(); ++il)
+    (*il)->thread = std::thread(& Lane::run, il->get());
+
+  // read input, handing each batch to every configuration
+
+  std::vector < Hit > * batch = new std::vector < Hit > ();
+  batch->reserve(HITS_PER_BATCH);
+  auto dispatch = [&]() {
+    Hit_Batch b(batch);
+    for (auto il = lanes.begin(); il != lanes.end(); ++il)
+      (*il)->in.push(Hit_Batch(b));
+    batch = new std::vector < Hit > ();
+    batch->reserve(HITS_PER_BATCH);
+  };
+
+  string error;
+  try {
+    Hit h;
+    while (data->next(h)) {
+      batch->push_back(h);
+      if (batch->size() == HITS_PER_BATCH)
+        dispatch();
+    }
+    if (batch->size() > 0)
+      dispatch();
+  } catch (std::runtime_error & e) {
+    error = e.what();
+  }
+  delete batch;
+
+  for (auto il = lanes.begin(); il != lanes.end(); ++il) {
+    (*il)->in.close();
+    (*il)->thread.join();
+    if (error.length() == 0 && (*il)->error.length() > 0)
+      error = (*il)->error;
+  }
+  if (error.length() > 0)
+    throw std::runtime_error(error);
+
+  (*summary) << "\"name\",\"burstSlop\",\"burstSlopExpansion\",\"hitsToConfirm\",\"maxSkippedBursts\",\"timestampWonkiness\",\"runs\",\"hits\"" << std::endl;
+  for (unsigned int i = 0; i < configs.size(); ++i) {
+    const Run_Params & p = configs[i].params;
+    (*summary) << '"' << configs[i].name << '"'
+               << ',' << p.burst_slop * 1000.0
+               << ',' << p.burst_slop_expansion * 1000.0
+               << ',' << p.hits_to_confirm_id
+               << ',' << p.max_skipped_bursts
+               << ',' << p.timestamp_wonkiness
+               << ',' << lanes[i]->sink.runs
+               << ',' << lanes[i]->sink.hits
+               << std::endl;
+  }
+};
@@ -0,0 +1,73 @@
+#ifndef PARAM_SWEEP_HPP
+#define PARAM_SWEEP_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Run_Params.hpp"
+#include "Tag_Database.hpp"
+#include "Hit_Source.hpp"
+#include "Output_Sink.hpp"
+
+#include <vector>
+
+class Param_Sweep {
+
+  // Find runs in the same input with several sets of parameters at
+  // once.  Each set, called a configuration, gets its own Run_Foray
+  // on its own thread, with its own Output_Sink.  Input is read and
+  // parsed only once, by the thread calling start(), and handed to
+  // every foray in shared batches.  Output for each configuration is
+  // identical to that from a separate run with its parameters.
+
+public:
+
+  struct Config {
+    string      name;
+    Run_Params  params;
+  };
+
+  Param_Sweep(Tag_Database * tags, Hit_Source * data);
+
+  // read configurations from filename, where each line is:
+  //
+  //   NAME,BSLOP,BSLOPEXP,CONFIRM,SKIPS,WONK
+  //
+  // giving values as for the options -b, -B, -c, -S and -t.  An empty
+  // field takes its value from defaults.  Blank lines and lines
+  // beginning with '#' are ignored.  Throws if the file can't be read
+  // or a line is malformed.
+
+  static std::vector < Config > read_configs(const string & filename, const Run_Params & defaults);
+
+  // find runs for configuration c, sending them to sink
+
+  void add_config(const Config & c, Output_Sink * sink);
+
+  // as for Run_Foray
+
+  void set_graph_cache_dir(const string & dir);
+
+  void set_lazy_graphs(bool lazy_graphs);
+
+  // process all input, then write a table with the number of runs
+  // and hits output for each configuration to summary
+
+  void start(ostream * summary);
+
+protected:
+  // input is handed out in batches of this size, and at most
+  // MAX_BATCHES_IN_FLIGHT batches are queued for each configuration
+
+  static const unsigned int HITS_PER_BATCH = 8192;
+  static const unsigned int MAX_BATCHES_IN_FLIGHT = 4;
+
+  Tag_Database * tags;
+  Hit_Source * data;
+  Hit_Codes codes;  // of hits read from data, shared by every configuration
+  std::vector < Config > configs;
+  std::vector < Output_Sink * > sinks;
+  string graph_cache_dir;
+  bool lazy_graphs;
+};
+
+#endif // PARAM_SWEEP_HPP
@@ -0,0 +1,177 @@
+#include "Receiver_Batch.hpp"
+
+#include "Run_Foray.hpp"
+#include "Run_Finder.hpp"
+#include "Run_Candidate.hpp"
+#include "CSV_Hit_Source.hpp"
+#include "Column_Hit_Source.hpp"
+#include "Binary_Sink.hpp"
+#include "Task_Pool.hpp"
+
+#include <fstream>
+#include <algorithm>
+
+Receiver_Batch::Receiver_Batch(Tag_Database * tags, const Run_Params & params) :
+  tags(tags),
+  params(params),
+  receivers(),
+  input_columns(false),
+  output_dir("."),
+  binary(false),
+  header(true),
+  graph_cache_dir(),
+  num_threads(1),
+  graphs()
+{
+};
+
+void
+Receiver_Batch::add_receiver(const string & filename) {
+  Receiver r;
+  r.input = filename;
+  size_t slash = filename.find_last_of("/\\");
+  r.name = slash == string::npos ? filename : filename.substr(slash + 1);
+  size_t dot = r.name.find_last_of('.');
+  if (dot != string::npos && dot > 0)
+    r.name.erase(dot);
+  if (r.name.length() == 0)
+    throw std::runtime_error(string("Can't name output for input file ") + filename);
+  for (auto ir = receivers.begin(); ir != receivers.end(); ++ir)
+    if (ir->name == r.name)
+      throw std::runtime_error(string("Input files ") + ir->input + " and " + filename + " would have the same output file");
+  receivers.push_back(r);
+};
+
+void
+Receiver_Batch::set_input_columns(bool input_columns) {
+  this->input_columns = input_columns;
+};
+
+void
+Receiver_Batch::set_output(const string & dir, bool binary, bool header) {
+  output_dir = dir;
+  this->binary = binary;
+  this->header = header;
+};
+
+void
+Receiver_Batch::set_graph_cache_dir(const string & dir) {
+  graph_cache_dir = dir;
+};
+
+void
+Receiver_Batch::set_num_threads(unsigned int num_threads) {
+  this->num_threads = num_threads > 0 ? num_threads : 1;
+};
+
+void
+Receiver_Batch::build_graphs() {
+
+  // the cache only holds compiled edges, so with icl edges each
+  // receiver's foray builds its own graphs
+
+  if (! DFA_Node::use_flat_edges)
+    return;
+
+  uint64_t key = Graph_Cache::get_key(tags, params);
+  string cache_file;
+  std::unique_ptr < Graph_Cache > file_cache;
+  if (graph_cache_dir.length() > 0) {
+    cache_file = Graph_Cache::get_filename(graph_cache_dir, key);
+    file_cache.reset(Graph_Cache::open(cache_file, key));
+  }
+
+  // run finders like those of a foray, used only to build the graphs
+  // (or attach those from the cache file, which warns about ambiguous
+  // tags just once, rather than once per receiver)
+
+  std::vector < std::unique_ptr < Run_Finder > > protos;
+  std::vector < Run_Finder * > rfs;
+  Freq_Set & nf = tags->get_nominal_freqs();
+  for (auto ifs = nf.begin(); ifs != nf.end(); ++ifs) {
+    Run_Finder * rf = new Run_Finder(0, params, *ifs, "");
+    protos.push_back(std::unique_ptr < Run_Finder > (rf));
+    rfs.push_back(rf);
+    Tag_Set * tgs = tags->get_tags_at_freq(*ifs);
+    for (auto it = tgs->begin(); it != tgs->end(); ++it)
+      rf->add_tag(*it);
+    rf->init(file_cache.get(), false);
+  }
+
+  if (file_cache) {
+    graphs = std::move(file_cache);
+  } else {
+    if (cache_file.length() > 0)
+      Graph_Cache::write(cache_file, key, rfs);
+    graphs.reset(Graph_Cache::build(key, rfs));
+  }
+  graphs->set_quiet(true);
+};
+
+void
+Receiver_Batch::run_receiver(Receiver & r) {
+
+  std::unique_ptr < Line_Reader > lines;
+  std::unique_ptr < Hit_Source > hits;
+  if (input_columns) {
+    hits.reset(new Column_Hit_Source(r.input));
+  } else {
+    lines.reset(Line_Reader::open(r.input));
+    hits.reset(new CSV_Hit_Source(lines.get()));
+  }
+
+  string filename = output_dir + "/" + r.name + (binary ? ".ftb" : ".csv");
+  std::ofstream f(filename.c_str(), binary ? std::ios::out | std::ios::binary : std::ios::out);
+  if (! f.good())
+    throw std::runtime_error(string("Couldn't open output file ") + filename);
+
+  std::unique_ptr < Output_Sink > sink;
+  if (binary) {
+    sink.reset(new Binary_Sink(& f));
+  } else {
+    if (header)
+      Run_Candidate::output_header(& f);
+    sink.reset(new Buffered_CSV_Sink(& f));
+  }
+
+  {
+    Run_Foray foray(tags, hits.get(), sink.get());
+    foray.set_params(params);
+    foray.set_shared_graphs(graphs.get());
+    foray.start();
+  }
+
+  // the sink writes anything it still holds when destroyed
+
+  sink.reset();
+  f.close();
+  if (f.fail())
+    throw std::runtime_error(string("Couldn't write output file ") + filename);
+};
+
+void
+Receiver_Batch::start() {
+  if (receivers.size() == 0)
+    return;
+
+  build_graphs();
+
+  Task_Pool pool(std::min(num_threads, (unsigned int) receivers.size()));
+  std::vector < Task_Pool::Task > tasks;
+  for (auto ir = receivers.begin(); ir != receivers.end(); ++ir) {
+    Receiver * r = & *ir;
+    tasks.push_back([this, r]() {
+        try {
+          run_receiver(*r);
+        } catch (std::runtime_error & e) {
+          r->error = e.what();
+        }
+      });
+  }
+  pool.submit(tasks);
+  pool.wait();
+
+  for (auto ir = receivers.begin(); ir != receivers.end(); ++ir)
+    if (ir->error.length() > 0)
+      throw std::runtime_error(string("Receiver ") + ir->input + ": " + ir->error);
+};
@@ -0,0 +1,84 @@
+#ifndef RECEIVER_BATCH_HPP
+#define RECEIVER_BATCH_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Run_Params.hpp"
+#include "Tag_Database.hpp"
+#include "Graph_Cache.hpp"
+
+#include <vector>
+#include <memory>
+
+class Receiver_Batch {
+
+  // Filter the input files of many receivers against the same tags
+  // and parameters.  The DFA graphs are built (or read from a graph
+  // cache) only once, and shared by every receiver; each receiver
+  // otherwise gets its own Run_Foray, with its own candidates, run
+  // IDs, antenna and codeset tables and hit numbering (see Hit_Codes),
+  // and its own output file.  Receivers are filtered on a pool of
+  // threads.  Output for each receiver is identical to that from a
+  // separate run on its input file, including the antenna table of
+  // binary output.
+
+public:
+
+  Receiver_Batch(Tag_Database * tags, const Run_Params & params);
+
+  // filter the hits in .CSV file filename (or binary column file; see
+  // set_input_columns()); output goes to a file in
+  // the output directory named for filename without its directory or
+  // extension.  Throws if that is the same as for a receiver already
+  // added.
+
+  void add_receiver(const string & filename);
+
+  // read every input file as binary columns (see Column_Hit_Source),
+  // rather than as .CSV
+
+  void set_input_columns(bool input_columns);
+
+  // write output to directory dir as .CSV (with a header, if header
+  // is true), or as binary (see Binary_Sink), with extension .ftb
+
+  void set_output(const string & dir, bool binary, bool header);
+
+  // as for Run_Foray
+
+  void set_graph_cache_dir(const string & dir);
+
+  // filter at most this many receivers at once; default: 1
+
+  void set_num_threads(unsigned int num_threads);
+
+  // filter every receiver's input.  If any fail, the others are still
+  // filtered, then the first error is thrown.
+
+  void start();
+
+protected:
+  struct Receiver {
+    string input;    // name of input file
+    string name;     // input file's name without directory or extension
+    string error;    // why filtering failed; empty if it didn't
+  };
+
+  Tag_Database * tags;
+  Run_Params params;
+  std::vector < Receiver > receivers;
+  bool input_columns;
+  string output_dir;
+  bool binary;
+  bool header;
+  string graph_cache_dir;
+  unsigned int num_threads;
+
+  std::unique_ptr < Graph_Cache > graphs; // shared by all receivers; null with icl edges
+
+  void build_graphs();
+
+  void run_receiver(Receiver & r);
+};
+
+#endif // RECEIVER_BATCH_HPP
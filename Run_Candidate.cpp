@@ -2,9 +2,10 @@
 
 #include "Run_Foray.hpp"
 
-Run_Candidate::Run_Candidate (Run_Finder *owner, DFA_Node *state, const Hit &h) :
+Run_Candidate::Run_Candidate (Run_Finder *owner, DFA_Graph *graph, const Hit &h) :
   owner(owner),
-  state(state),
+  graph(graph),
+  state(graph->get_root()),
   hits(),
   first_ts(0),
   last_ts(h.ts),
@@ -13,12 +14,41 @@ Run_Candidate::Run_Candidate (Run_Finder *owner, DFA_Node *state, const Hit &h)
   in_a_row(0),
   bi(0.0)
 {
-  static unsigned long long run_id_counter = 0;
-
-  run_id = ++run_id_counter;
+  run_id = owner->sink->new_run_id(h);
   hits[h.seq_no] = h;
 };
 
+Run_Candidate::Run_Candidate (Run_Finder *owner, DFA_Graph *graph, const Checkpoint::Candidate &c, Known_Tag *conf_tag) :
+  owner(owner),
+  graph(graph),
+  state(graph->node_at(c.state)),
+  hits(),
+  first_ts(c.first_ts),
+  last_ts(c.last_ts),
+  last_dumped_ts(c.last_dumped_ts),
+  conf_tag(conf_tag),
+  in_a_row(c.in_a_row),
+  bi(c.bi),
+  run_id(c.run_id)
+{
+  for (auto ih = c.hits.begin(); ih != c.hits.end(); ++ih)
+    hits[ih->seq_no] = *ih;
+};
+
+void Run_Candidate::save(Checkpoint::Candidate &c) {
+  c.tag = conf_tag ? conf_tag->fullID : string();
+  c.state = graph->index_of(state);
+  c.first_ts = first_ts;
+  c.last_ts = last_ts;
+  c.last_dumped_ts = last_dumped_ts;
+  c.in_a_row = in_a_row;
+  c.bi = bi;
+  c.run_id = run_id;
+  c.hits.clear();
+  for (Hits_Iter ih = hits.begin(); ih != hits.end(); ++ih)
+    c.hits.push_back(ih->second);
+};
+
 bool Run_Candidate::has_same_id_as(Run_Candidate &tf) {
   Tag_ID id = get_tag_id();
   return id != BOGUS_TAG_ID && id == tf.get_tag_id();
@@ -36,7 +66,15 @@ bool Run_Candidate::shares_any_hits(Run_Candidate &tf) {
 };
 
 bool Run_Candidate::is_too_old_given_hit_time(const Hit &h) {
-  return h.ts - last_ts > state->get_max_age();
+  return is_too_old_given_time(h.ts);
+};
+
+bool Run_Candidate::is_too_old_given_time(Timestamp ts) {
+  return ts - last_ts > state->get_max_age();
+};
+
+Timestamp Run_Candidate::get_deadline() {
+  return last_ts + state->get_max_age();
 };
 
 DFA_Node * Run_Candidate::advance_by_hit(const Hit &h) {
@@ -44,21 +82,21 @@ DFA_Node * Run_Candidate::advance_by_hit(const Hit &h) {
   Gap gap = h.ts - last_ts;
 
   // try walk the DFA with this gap
-  DFA_Node * rv = state->next(gap);
-  if (! rv ||  ! Run_Finder::timestamp_wonkiness || ! first_ts || ! conf_tag)
+  DFA_Node * rv = graph->next(state, gap);
+  if (! rv ||  ! owner->timestamp_wonkiness || ! first_ts || ! conf_tag)
     return rv;
 
   // we've been allowing for clock jumps, but we don't want them to be
   // biased in one direction, which would allow a tag with a different
   // BI to be falsely detected.  So verify that adding this hit won't
   // result in a total time wonkiness for this run of more than
-  // Run_Finder::timestamp_wonkiness in absolute value.  Note: this
+  // the Run_Finder's timestamp_wonkiness in absolute value.  Note: this
   // test will fail if the tag's burst interval is smaller than
-  // Run_Finder::timestamp_wonkiness!!
+  // timestamp_wonkiness!!
 
   int num_bursts = round((h.ts - first_ts) / conf_tag->bi);
 
-  if (round(abs((h.ts - first_ts) - num_bursts * conf_tag->bi)) <= Run_Finder::timestamp_wonkiness)
+  if (round(abs((h.ts - first_ts) - num_bursts * conf_tag->bi)) <= owner->timestamp_wonkiness)
     return rv;
 
   // too much wonkiness, so don't accept this hit.
@@ -88,8 +126,8 @@ bool Run_Candidate::add_hit(const Hit &h, DFA_Node *new_state) {
 
   // does this new burst confirm the tagID ?
 
-  if ((! conf_tag) && hits.size() >= hits_to_confirm_id) {
-    conf_tag = owner->owner->tags->get_tag(state->get_ID());
+  if ((! conf_tag) && hits.size() >= owner->hits_to_confirm_id) {
+    conf_tag = owner->owner->tags->get_tag(graph->get_ID(state));
     bi = conf_tag->bi;
     return true;
   }
@@ -109,7 +147,7 @@ bool Run_Candidate::is_confirmed() {
 
 bool
 Run_Candidate::next_hit_confirms() {
-  return conf_tag == 0 && hits.size() == hits_to_confirm_id - 1;
+  return conf_tag == 0 && hits.size() == owner->hits_to_confirm_id - 1;
 };
 
 
@@ -126,7 +164,7 @@ Run_Candidate::output_header(ostream * out) {
          << std::endl;
 };
 
-void Run_Candidate::dump_hits(ostream *os, string prefix) {
+void Run_Candidate::dump_hits(Output_Sink *out, string prefix) {
   // dump all hits in the run so far
 
   for (Hits_Iter ih = hits.begin(); ih != hits.end(); ++ih) {
@@ -138,34 +176,10 @@ void Run_Candidate::dump_hits(ostream *os, string prefix) {
       bs = BOGUS_BURST_SLOP;
     }
     ++in_a_row;
-    (*os) << prefix
-          << std::setprecision(14)
-          << ih->second.ts
-          << std::setprecision(4)
-          << ',' << Run_Foray::ant_codes[ih->second.ant_code]
-	  << ',' << conf_tag->fullID
-	  << ',' << run_id
-	  << ',' << in_a_row
-	  << ',' << ih->second.sig
-	  << ',' << bs
-          << ',' << ih->second.dtaline
-          << std::setprecision(9)
-          << ',' << ih->second.lat
-          << ',' << ih->second.lon
-          << std::setprecision(6)
-          << ',' << ih->second.ant_freq
-          << std::setprecision(4)
-          << ',' << ih->second.gain
-          << std::endl;
+    out->put(prefix, ih->second, conf_tag, run_id, in_a_row, bs);
     last_dumped_ts = ih->second.ts;
   }
   clear_hits();
 };
 
-void Run_Candidate::set_hits_to_confirm_id(unsigned int n) {
-  hits_to_confirm_id = n;
-};
-
-unsigned int Run_Candidate::hits_to_confirm_id = 2; // default to at least 2 bursts required; choosing 1 would make filtering a NO-OP
-
 const float Run_Candidate::BOGUS_BURST_SLOP = 0.0; // burst slop reported for first burst of ru
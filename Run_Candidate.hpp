@@ -6,14 +6,31 @@
 
 #include "filter_tags_common.hpp"
 
-#include "DFA_Node.hpp"
+#include "DFA_Graph.hpp"
 #include "Hit.hpp"
 #include "Freq_Setting.hpp"
 #include "Known_Tag.hpp"
+#include "Output_Sink.hpp"
+#include "Checkpoint.hpp"
 
 class Run_Finder;
 
-class Run_Candidate {
+struct Cand_Link {
+
+  // linkage for keeping Run_Candidates on a Cand_List; a copy of a
+  // candidate is not on any list
+
+  Cand_Link * prev;
+  Cand_Link * next;
+
+  Cand_Link() : prev(0), next(0) {};
+
+  Cand_Link(const Cand_Link &) : prev(0), next(0) {};
+
+  Cand_Link & operator= (const Cand_Link &) {return *this;};
+};
+
+class Run_Candidate : public Cand_Link {
 
   /* an automaton walking the DFA graph to find valid runs of detections from a single physical tag */
 
@@ -21,7 +38,8 @@ private:
   // fundamental structure
 
   Run_Finder         *owner;          // which Run_Finder owns me?
-  DFA_Node           *state;          // where in the appropriate DFA I am
+  DFA_Graph          *graph;          // the DFA for my tag's Lotek ID
+  DFA_Node           *state;          // where in that DFA I am
   Hit_Buffer          hits;           // hits in the path so far
   Timestamp           first_ts;       // timestamp of first burst in this run
   Timestamp           last_ts;        // timestamp of last burst
@@ -36,9 +54,14 @@ public:
 
   unsigned long long  run_id;         // unique ID for this run
 
-  static unsigned int hits_to_confirm_id; // how many hits must be seen before an ID level moves to confirmed?
+  Run_Candidate(Run_Finder *owner, DFA_Graph *graph, const Hit &h);
 
-  Run_Candidate(Run_Finder *owner, DFA_Node *state, const Hit &h);
+  // recreate a candidate saved by save(); conf_tag is the tag named
+  // in c, or 0 if c is unconfirmed
+
+  Run_Candidate(Run_Finder *owner, DFA_Graph *graph, const Checkpoint::Candidate &c, Known_Tag *conf_tag);
+
+  void save(Checkpoint::Candidate &c);
 
   bool has_same_id_as(Run_Candidate &tf);
 
@@ -46,6 +69,10 @@ public:
 
   bool is_too_old_given_hit_time(const Hit &h);
 
+  bool is_too_old_given_time(Timestamp ts); // could no hit at ts or later be added?
+
+  Timestamp get_deadline(); // about when the candidate becomes too old; is_too_old_given_time() is exact
+
   DFA_Node * advance_by_hit(const Hit &h);
 
   bool add_hit(const Hit &h, DFA_Node *new_state);
@@ -58,11 +85,13 @@ public:
 
   void clear_hits();
 
-  static void output_header(ostream *out);
+  const Hit_Buffer & get_hits() const {return hits;};
+
+  Timestamp get_last_ts() const {return last_ts;};
 
-  void dump_hits(ostream *os, string prefix="");
+  static void output_header(ostream *out);
 
-  static void set_hits_to_confirm_id(unsigned int n);
+  void dump_hits(Output_Sink *out, string prefix="");
 };
 
 #endif // RUN_CANDIDATE_HPP
@@ -1,19 +1,41 @@
 #include "Run_Finder.hpp"
+#include "Graph_Cache.hpp"
+
+#include <sstream>
+#include <algorithm>
 
 Run_Finder::Run_Finder (Run_Foray *owner) :
-  owner(owner)
+  owner(owner),
+  graph_cache(0),
+  watermark(0),
+  expiry_lag(-1),
+  cands_evicted(0),
+  sink(0)
 {
 };
 
-Run_Finder::Run_Finder (Run_Foray *owner, Nominal_Frequency_kHz nom_freq, string prefix) :
+Run_Finder::Run_Finder (Run_Foray *owner, const Run_Params & params, Nominal_Frequency_kHz nom_freq, string prefix) :
   owner(owner),
   tags_not_in_db(),
   nom_freq(nom_freq),
   G(),
+  graph_cache(0),
+  slab(),
   cands(),
-  burst_slop(default_burst_slop),
-  burst_slop_expansion(default_burst_slop_expansion),
-  max_skipped_bursts(default_max_skipped_bursts),
+  id_slots(),
+  hit_index(),
+  deadlines(),
+  watermark(0),
+  expiry_lag(params.expiry_lag),
+  burst_slop(params.burst_slop),
+  burst_slop_expansion(params.burst_slop_expansion),
+  max_skipped_bursts(params.max_skipped_bursts),
+  hits_to_confirm_id(params.hits_to_confirm_id),
+  timestamp_wonkiness(params.timestamp_wonkiness),
+  max_cands_per_id(params.max_cands_per_id),
+  max_cands_total(params.max_cands_total),
+  cands_evicted(0),
+  sink(0),
   prefix(prefix)
 {
 };
@@ -26,27 +48,67 @@ Run_Finder::add_tag(Known_Tag * t)
 
   Lotek_Tag_ID lid = t->lid;
   if (G.count(lid) == 0)
-    G.insert(std::pair < Lotek_Tag_ID, DFA_Graph > (lid, DFA_Graph(Run_Candidate::hits_to_confirm_id * 10)));
+    G.insert(std::pair < Lotek_Tag_ID, DFA_Graph > (lid, DFA_Graph(hits_to_confirm_id * 10)));
   G[lid].add_tag(t);
 
 #ifdef FILTER_TAGS_DEBUG2
   std::cerr << "Adding tag " << t->id << " @ " << t->freq / 1000.0 << std::endl;
 #endif
 
-  if (cands.count(lid) == 0)
-    cands[lid] = std::vector < Cand_List > (NUM_CAND_LISTS);
+  if (cands.count(lid) == 0) {
+    std::vector < Cand_List > & cl = cands[lid];
+    for (int i = 0; i < NUM_CAND_LISTS; ++i)
+      cl.emplace_back(& slab);
+
+    // elements of unordered maps never move, so the slot stays valid
+
+    if (lid >= 0 && lid < MAX_SLOT_ID && (int) lid == lid) {
+      if (id_slots.size() <= (size_t) lid)
+        id_slots.resize((size_t) lid + 1, ID_Slot());
+      ID_Slot s = {& cl, & G[lid]};
+      id_slots[(size_t) lid] = s;
+    }
+  }
 }
 
+Run_Finder::ID_Slot
+Run_Finder::find_slot(Lotek_Tag_ID lid) {
+  ID_Slot s = {0, 0};
+  if (lid >= 0 && lid < MAX_SLOT_ID && (int) lid == lid) {
+    if ((size_t) lid < id_slots.size())
+      s = id_slots[(size_t) lid];
+    return s;
+  }
+  auto ic = cands.find(lid);
+  if (ic != cands.end()) {
+    s.cands = & ic->second;
+    s.graph = & G[lid];
+  }
+  return s;
+};
+
 void
-Run_Finder::setup_graphs() {
+Run_Finder::setup_graphs(Graph_Cache * cache, bool lazy) {
   // Create the DFA graphs for the database of registered tags
   // There is one graph for each set of tags having the same Lotek ID
-  // and on the same frequency
+  // and on the same frequency.  If lazy is true, each graph is only
+  // created when the first hit with its Lotek ID arrives; see get_graph().
+
+  graph_cache = cache;
+  if (lazy)
+    return;
+
+  // loop over each graph (i.e. each lotek ID)
+  for (auto ig = G.begin(); ig != G.end(); ++ig)
+    build_graph(ig->first, ig->second);
+};
 
-  // The graphs have already had their root nodes created by calling add_tag
-  // for each tag on this Run_Finder's frequency.
+void
+Run_Finder::build_graph(Lotek_Tag_ID lid, DFA_Graph & g) {
+  // The graph has already had its root node created by calling add_tag
+  // for each tag on this Run_Finder's frequency with Lotek ID lid.
 
-  // For depth up to Run_Candidate::hits_to_confirm_id, add appropriate nodes to the graph.
+  // For depth up to hits_to_confirm_id, add appropriate nodes to the graph.
   // This is done breadth-first, but non-recursively because the DFA_Graph
   // class keeps a vector of nodes at each phase.
   // We start by looking at all nodes in the previous phase.
@@ -54,103 +116,105 @@ Run_Finder::setup_graphs() {
   // pulse gaps for the current phase (including slop) to subsets of these
   // Tag_IDs.
 
-  // loop over each graph (i.e. each lotek ID)
-  for (auto ig = G.begin(); ig != G.end(); ++ig) {
-    DFA_Graph &g = ig->second;
-    g.setup_root();
+  // (written in one piece, as graphs may be set up on several threads at once)
+  auto warn_ambiguous = [this, lid]() {
+    std::ostringstream msg;
+    msg << "Warning: some tags with lotek ID " << lid << " @ " << nom_freq / 1000.0 << " are not distinguishable.\n";
+    std::cerr << msg.str();
+  };
+
+  if (graph_cache && graph_cache->attach(nom_freq, lid, g)) {
+    if (g.ambiguous && ! graph_cache->is_quiet())
+      warn_ambiguous();
+    return;
+  }
+
+  g.setup_root();
 
-    bool have_nonsingleton_leaves = true;
+  bool have_nonsingleton_leaves = true;
 
-    // loop over each depth (i.e. breadth-first)
-    unsigned int depth;
-    for (depth = 0; have_nonsingleton_leaves && depth < g.max_depth; ++depth) {
+  // loop over each depth (i.e. breadth-first)
+  unsigned int depth;
+  for (depth = 0; have_nonsingleton_leaves && depth < g.max_depth; ++depth) {
 
-      have_nonsingleton_leaves = false;
+    have_nonsingleton_leaves = false;
 
-      Node_Map & nm = g.N[depth];
+    Node_Map & nm = g.N[depth];
 
-      // loop over each node at this depth
-      for (auto in = nm.begin(); in != nm.end(); ++in) {
+    // loop over each node at this depth
+    for (auto in = nm.begin(); in != nm.end(); ++in) {
 
-        // a map of gap sizes to compatible tag IDs
-        interval_map < Gap, Tag_ID_Set > m;
+      // a map of gap sizes to compatible tag IDs
+      interval_map < Gap, Tag_ID_Set > m;
 
-        // for each tag in this node, add edges for fuzzified
-        // multiples of its burst interval
+      // for each tag in this node, add edges for fuzzified
+      // multiples of its burst interval
 
-        have_nonsingleton_leaves |= in->first.size() > 1;
+      have_nonsingleton_leaves |= in->first.size() > 1;
 
-        for (auto i = in->first.begin(); i != in->first.end(); ++i) {
-          Tag_ID_Set id;
-          id.insert(*i);
-          Gap bi = (*i)->bi;
-          for (unsigned int k = 1; k <= max_skipped_bursts + 1; ++k) {
-            Gap slop =  burst_slop + burst_slop_expansion * (k - 1);
-            m.add(make_pair(interval < Gap > :: closed(bi * k - slop, bi * k + slop), id));
-            if (timestamp_wonkiness) {
-              // add additional edges for BI which are off by +/-1, +/-2, ... seconds due to clock steps
-              for (unsigned int tw = 1; tw <= timestamp_wonkiness; ++tw) {
-                m.add(make_pair(interval < Gap > :: closed(bi * k - slop + tw, bi * k + slop + tw), id));
-                m.add(make_pair(interval < Gap > :: closed(bi * k - slop - tw, bi * k + slop - tw), id));
-              }
+      for (auto i = in->first.begin(); i != in->first.end(); ++i) {
+        Tag_ID_Set id;
+        id.insert(*i);
+        Gap bi = (*i)->bi;
+        for (unsigned int k = 1; k <= max_skipped_bursts + 1; ++k) {
+          Gap slop =  burst_slop + burst_slop_expansion * (k - 1);
+          m.add(make_pair(interval < Gap > :: closed(bi * k - slop, bi * k + slop), id));
+          if (timestamp_wonkiness) {
+            // add additional edges for BI which are off by +/-1, +/-2, ... seconds due to clock steps
+            for (unsigned int tw = 1; tw <= timestamp_wonkiness; ++tw) {
+              m.add(make_pair(interval < Gap > :: closed(bi * k - slop + tw, bi * k + slop + tw), id));
+              m.add(make_pair(interval < Gap > :: closed(bi * k - slop - tw, bi * k + slop - tw), id));
             }
           }
         }
+      }
 
-        // grow the node by this interval_map; Pulses at phase 2 *
-        // PULSES_PER_BURST-1 are linked back to pulses at phase
-        // PULSES_PER_BURST-1, so that we can keep track of runs of
-        // consecutive bursts from a tag
+      // grow the node by this interval_map; Pulses at phase 2 *
+      // PULSES_PER_BURST-1 are linked back to pulses at phase
+      // PULSES_PER_BURST-1, so that we can keep track of runs of
+      // consecutive bursts from a tag
 
-        g.grow(in->second, m, (in->first.size() > 1 && depth < Run_Candidate::hits_to_confirm_id - 1) ? depth + 1 : depth);
-      }
+      g.grow(in->second, m, (in->first.size() > 1 && depth < hits_to_confirm_id - 1) ? depth + 1 : depth);
     }
+  }
 
-    // sanity check: for each node at max depth, ensure there's only one tag ID left
-    if (have_nonsingleton_leaves) {
-      std::cerr << "Warning: some tags with lotek ID " << ig->first << " @ " << nom_freq / 1000.0 << " are not distinguishable.\n";
-    } else {
+  // sanity check: for each node at max depth, ensure there's only one tag ID left
+  g.ambiguous = have_nonsingleton_leaves;
+  if (have_nonsingleton_leaves) {
+    warn_ambiguous();
+  } else {
 #ifdef FILTER_TAGS_DEBUG
-      std::cerr <<"All tags with Lotek ID " << ig->first << " @ " << nom_freq / 1000.0 << " can be distinguished after at most " << depth << " bursts.\n";
+    std::cerr <<"All tags with Lotek ID " << lid << " @ " << nom_freq / 1000.0 << " can be distinguished after at most " << depth << " bursts.\n";
 #endif
-    }
   }
-};
 
+  // the graph won't change from here on
 
-void
-Run_Finder::set_default_burst_slop_ms(float burst_slop_ms) {
-  default_burst_slop = burst_slop_ms / 1000.0;	// stored as seconds
+  g.compile();
 };
 
-void
-Run_Finder::set_default_burst_slop_expansion_ms(float burst_slop_expansion_ms) {
-  default_burst_slop_expansion = burst_slop_expansion_ms / 1000.0;   // stored as seconds
-};
 
 void
-Run_Finder::set_default_max_skipped_bursts(unsigned int skip) {
-  default_max_skipped_bursts = skip;
+Run_Finder::set_sink(Output_Sink * sink) {
+  this->sink = sink;
 };
 
-void
-Run_Finder::set_out_stream(ostream * os) {
-  out_stream = os;
+DFA_Graph *
+Run_Finder::get_graph(Lotek_Tag_ID lid) {
+  DFA_Graph & g = G[lid];
+  if (! g.is_built())
+    build_graph(lid, g);
+  return & g;
 };
 
 void
-Run_Finder::set_timestamp_wonkiness(unsigned int wonk) {
-  timestamp_wonkiness = wonk;
-};
-
-void
-Run_Finder::init() {
-  setup_graphs();
+Run_Finder::init(Graph_Cache * cache, bool lazy) {
+  setup_graphs(cache, lazy);
 #ifdef FILTER_TAGS_DEBUG_2
   std::cerr << "Graphs for " << nom_freq << std::endl;
   for (Graph_Map::iterator ig = G.begin(); ig != G.end(); ++ig) {
     std::cerr << ig->first << std::endl;
-    ig->second.get_root()->dump(std::cerr);
+    ig->second.dump(std::cerr);
   }
 #endif
 };
@@ -182,16 +246,25 @@ Run_Finder::process(Hit &h) {
     Run_Candidate with this hit
   */
 
-  if (h.lid == 999)
+  FT_STAT(Foray_Stats::Timer process_timer(stats.process_ns));
+
+  if (h.lid == 999) {
+    FT_STAT(++stats.hits_bogus);
     return;
+  }
 
-  if (cands.count(h.lid) == 0) {
+  ID_Slot slot = find_slot(h.lid);
+  if (! slot.cands) {
+    FT_STAT(++stats.hits_not_in_db);
     tags_not_in_db.insert(h.lid);
     return;
   }
+  std::vector < Cand_List > & cl = * slot.cands;
+
+  FT_STAT(stats.cand_list_lengths.add(num_candidates(h.lid)));
 
   // the clone list
-  Cand_List & cloned_candidates = cands[h.lid][2];
+  Cand_List & cloned_candidates = cl[2];
 
   // loop over confirmed then unconfirmed candidates
 
@@ -203,25 +276,21 @@ Run_Finder::process(Hit &h) {
     // also, we don't start a new candidate with a hit unless we've already tried
     // letting unconfirmed candidates accept it.
 
-    Cand_List & cs = cands[h.lid][i];
+    Cand_List & cs = cl[i];
 
     for (Cand_List::iterator ci = cs.begin(); ! confirmed_acceptance && ci != cs.end(); /**/ ) {
       if (ci->is_too_old_given_hit_time(h)) {
-
-        if (ci->is_confirmed()) {
-          ci->dump_hits(out_stream, prefix);
-        }
-
-        Cand_List::iterator di = ci;
-        ++ci;
-        cs.erase(di);
+        retire(& *ci);
+        ci = cs.erase(ci);
         continue;
       }
 
       // see whether this Tag Candidate can accept this hit
       DFA_Node * next_state = ci->advance_by_hit(h);
+      FT_STAT(++stats.dfa_lookups);
 
       if (!next_state) {
+        FT_STAT(++stats.dfa_misses);
         ++ci;
         continue;
       }
@@ -234,38 +303,38 @@ Run_Finder::process(Hit &h) {
       if (! ci->is_confirmed() && ! ci->next_hit_confirms()) {
         // clone the candidate, without the added hit
         cloned_candidates.push_back(*ci);
+        FT_STAT(++stats.cands_cloned);
+        index_hits(& cloned_candidates.back());
+        schedule(& cloned_candidates.back(), h.lid);
       }
 
-      if (ci->add_hit(h, next_state)) {
+      if (! ci->is_confirmed())
+        index_hit(h.seq_no, & *ci);
+
+      bool just_confirmed = ci->add_hit(h, next_state);
+      schedule(& *ci, h.lid);
+      if (just_confirmed) {
         // this run candidate has just been confirmed.
-        // See what candidates should be deleted because they
-        // have the same ID or share any pulses.
-        // we check unconfirmed and cloned lists (indices 1 and 2 of cands[h.lid])
-
-        for (int j = 1; j < NUM_CAND_LISTS; ++j) {
-          Cand_List & ccs = cands[h.lid][j];
-          for (Cand_List::iterator cci = ccs.begin(); cci != ccs.end(); /**/ ) {
-            if (cci != ci
-                && (cci->has_same_id_as(*ci) || cci->shares_any_hits(*ci)))
-              {
-                Cand_List::iterator di = cci;
-                ++cci;
-                ccs.erase(di);
-              } else {
-              ++cci;
-            };
-          }
-        }
+        // Delete the candidates which share any pulses with it.
+        // Only unconfirmed and cloned candidates (lists 1 and 2 of cl)
+        // can be deleted, and as none of those is confirmed, none can have the same ID.
+
+        FT_STAT(++stats.cands_confirmed);
+
+        kill_conflicting(& *ci, cs);
 
         // push this candidate to end of the confirmed list
         // so it has priority for accepting new hits
 
-        Cand_List &confirmed = cands[h.lid][0];
+        Cand_List &confirmed = cl[0];
         confirmed.splice(confirmed.end(), cs, ci);
       }
       if (ci->is_confirmed()) {
         // dump all hits from this confirmed run
-        ci->dump_hits(out_stream, prefix);
+        {
+          FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+          ci->dump_hits(sink, prefix);
+        }
 
         // don't start a new candidate with this pulse
         confirmed_acceptance = true;
@@ -278,7 +347,183 @@ Run_Finder::process(Hit &h) {
   }
   // maybe start a new Run_Candidate with this pulse
   if (! confirmed_acceptance) {
-    cands[h.lid][1].push_back(Run_Candidate(this, G[h.lid].get_root(), h));
+    if (! slot.graph->is_built())
+      build_graph(h.lid, * slot.graph);
+    cl[1].emplace_back(this, slot.graph, h);
+    FT_STAT(++stats.cands_created);
+    index_hit(h.seq_no, & cl[1].back());
+    schedule(& cl[1].back(), h.lid);
+  }
+  if (max_cands_per_id || max_cands_total)
+    enforce_budget(cl, h.ts);
+};
+
+void
+Run_Finder::schedule(Run_Candidate * c, Lotek_Tag_ID lid) {
+  if (expiry_lag < 0)
+    return;
+  Deadline d = {c->get_deadline(), c, lid};
+  deadlines.push(d);
+};
+
+void
+Run_Finder::set_expiry_lag(Gap lag) {
+  expiry_lag = lag;
+};
+
+void
+Run_Finder::advance(Timestamp watermark) {
+  if (watermark <= this->watermark)
+    return;
+  this->watermark = watermark;
+  if (expiry_lag >= 0)
+    expire(watermark - expiry_lag);
+};
+
+size_t
+Run_Finder::num_candidates(Lotek_Tag_ID lid) {
+  size_t n = 0;
+  std::vector < Cand_List > & cl = cands[lid];
+  for (auto il = cl.begin(); il != cl.end(); ++il)
+    for (Cand_List::iterator ci = il->begin(); ci != il->end(); ++ci)
+      ++n;
+  return n;
+};
+
+void
+Run_Finder::index_hit(Hit::Seq_No s, Run_Candidate * c) {
+  hit_index[s].push_back(c);
+};
+
+void
+Run_Finder::index_hits(Run_Candidate * c) {
+  const Hit_Buffer & hits = c->get_hits();
+  for (Hit_Buffer::const_iterator ih = hits.begin(); ih != hits.end(); ++ih)
+    index_hit(ih->first, c);
+};
+
+void
+Run_Finder::unindex_hits(Run_Candidate * c) {
+  const Hit_Buffer & hits = c->get_hits();
+  for (Hit_Buffer::const_iterator ih = hits.begin(); ih != hits.end(); ++ih) {
+    Hit_Index::iterator hi = hit_index.find(ih->first);
+    if (hi == hit_index.end())
+      continue;
+    std::vector < Run_Candidate * > & holders = hi->second;
+    for (size_t i = 0; i < holders.size(); ++i) {
+      if (holders[i] == c) {
+        holders[i] = holders.back();
+        holders.pop_back();
+        break;
+      }
+    }
+    if (holders.empty())
+      hit_index.erase(hi);
+  }
+};
+
+void
+Run_Finder::kill_conflicting(Run_Candidate * c, Cand_List & cs) {
+  // c has just been confirmed, so it leaves the index; then destroy
+  // every unconfirmed candidate still holding any of its hits.
+  // Unindexing a victim removes it from every entry, so each entry
+  // empties (and is erased) after its last holder is destroyed.
+
+  unindex_hits(c);
+  const Hit_Buffer & hits = c->get_hits();
+  for (Hit_Buffer::const_iterator ih = hits.begin(); ih != hits.end(); ++ih) {
+    Hit_Index::iterator hi;
+    while ((hi = hit_index.find(ih->first)) != hit_index.end()) {
+      Run_Candidate * victim = hi->second.back();
+      unindex_hits(victim);
+      cs.remove(victim);
+      FT_STAT(++stats.cands_killed);
+    }
+  }
+};
+
+void
+Run_Finder::enforce_budget(std::vector < Cand_List > & cl, Timestamp ts) {
+  // how many candidates there are mustn't depend on how far expiry
+  // has got, which depends on hits for other IDs
+
+  size_t n = 0;
+  for (int i = 0; i < 2; ++i) {
+    for (Cand_List::iterator ci = cl[i].begin(); ci != cl[i].end(); /**/ ) {
+      if (ci->is_too_old_given_time(ts)) {
+        retire(& *ci);
+        ci = cl[i].erase(ci);
+        continue;
+      }
+      ++n;
+      ++ci;
+    }
+  }
+
+  size_t excess = 0;
+  if (max_cands_per_id && n > max_cands_per_id)
+    excess = n - max_cands_per_id;
+  if (max_cands_total && slab.size() > max_cands_total)
+    excess = std::max(excess, slab.size() - max_cands_total);
+
+  // the least promising candidate has the fewest hits, and of those,
+  // the oldest last hit
+
+  Cand_List & cs = cl[1];
+  for (; excess > 0 && ! cs.empty(); --excess) {
+    Cand_List::iterator worst = cs.begin();
+    for (Cand_List::iterator ci = cs.begin(); ci != cs.end(); ++ci) {
+      size_t nh = ci->get_hits().size(), nw = worst->get_hits().size();
+      if (nh < nw || (nh == nw && ci->get_last_ts() < worst->get_last_ts()))
+        worst = ci;
+    }
+    unindex_hits(& *worst);
+    cs.erase(worst);
+    ++cands_evicted;
+    FT_STAT(++stats.cands_evicted);
+  }
+};
+
+void
+Run_Finder::expire(Timestamp watermark) {
+  std::vector < Deadline > held; // current entries only due from rounding
+  while (! deadlines.empty() && deadlines.top().ts < watermark) {
+    Deadline d = deadlines.top();
+    deadlines.pop();
+    if (slab.is_live(d.cand) && ! d.cand->is_too_old_given_time(watermark)) {
+      // a later deadline has been scheduled since, unless this one
+      // only looks due from rounding, in which case it goes back on
+      // the heap once the later entries have been walked
+      if (d.cand->get_deadline() == d.ts)
+        held.push_back(d);
+      continue;
+    }
+    if (! slab.is_live(d.cand))
+      continue;
+    retire(d.cand);
+
+    // A stale entry's slot can since have been reused by a candidate
+    // for another Lotek ID, so d.lid needn't be the candidate's ID.
+    // That is harmless, as Cand_List::remove() just unlinks the
+    // candidate from whichever list holds it, then frees its slot.
+
+    (* find_slot(d.lid).cands)[0].remove(d.cand);
+  }
+  for (auto ih = held.begin(); ih != held.end(); ++ih)
+    deadlines.push(*ih);
+};
+
+void
+Run_Finder::retire(Run_Candidate * c) {
+  // c is too old to take any more hits: end its run if it has one
+
+  FT_STAT(++stats.cands_expired);
+  if (c->is_confirmed()) {
+    FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+    c->dump_hits(sink, prefix);
+    sink->end_run(c->run_id);
+  } else {
+    unindex_hits(c);
   }
 };
 
@@ -291,7 +536,7 @@ Run_Finder::end_processing() {
     Cand_List &cs = cm->second[0];
     for (Cand_List::iterator ci = cs.begin(); ci != cs.end(); ++ci ) {
       // dump the bursts
-      ci->dump_hits(out_stream, prefix);
+      ci->dump_hits(sink, prefix);
     }
   }
 #endif
@@ -304,9 +549,57 @@ Run_Finder::end_processing() {
 
 };
 
-Gap Run_Finder::default_burst_slop = 0.010; // 10 ms
-Gap Run_Finder::default_burst_slop_expansion = 0.001; // 1ms = 1 part in 10000 for 10s BI
-unsigned int Run_Finder::default_max_skipped_bursts = 60;
-unsigned int Run_Finder::timestamp_wonkiness = 0;
+void
+Run_Finder::save_state(std::vector < Checkpoint::Group > & groups) {
+  for (Cand_List_Map::iterator cm = cands.begin(); cm != cands.end(); ++cm) {
+    if (cm->second[0].empty() && cm->second[1].empty())
+      continue;
+    groups.emplace_back();
+    Checkpoint::Group & g = groups.back();
+    g.nom_freq = nom_freq;
+    g.lid = cm->first;
+    g.num_nodes = G[cm->first].num_nodes();
+    for (int i = 0; i < 2; ++i) {
+      Cand_List & cs = cm->second[i];
+      for (Cand_List::iterator ci = cs.begin(); ci != cs.end(); ++ci) {
+        g.cands[i].emplace_back();
+        ci->save(g.cands[i].back());
+      }
+    }
+  }
+};
 
-ostream * Run_Finder::out_stream = 0;
+unsigned int
+Run_Finder::restore_state(const Checkpoint & cp, const std::unordered_map < string, Known_Tag * > & tags_by_id) {
+  unsigned int n = 0;
+  for (auto ig = cp.groups.begin(); ig != cp.groups.end(); ++ig) {
+    if (ig->nom_freq != nom_freq || cands.count(ig->lid) == 0)
+      continue;
+    DFA_Graph & g = * get_graph(ig->lid);
+    if (ig->num_nodes != g.num_nodes()) {
+      std::ostringstream msg;
+      msg << "Checkpoint does not match the tag database for Lotek ID " << ig->lid << " @ " << nom_freq / 1000.0;
+      throw std::runtime_error(msg.str());
+    }
+    for (int i = 0; i < 2; ++i) {
+      Cand_List & cs = cands[ig->lid][i];
+      for (auto ic = ig->cands[i].begin(); ic != ig->cands[i].end(); ++ic) {
+        Known_Tag * t = 0;
+        if (ic->tag.length() > 0) {
+          auto it = tags_by_id.find(ic->tag);
+          if (it == tags_by_id.end())
+            throw std::runtime_error(string("Checkpoint has a run for tag ") + ic->tag + ", which is not in the tag database");
+          t = it->second;
+        }
+        if (ic->state >= g.num_nodes())
+          throw std::runtime_error("Checkpoint file is corrupt");
+        cs.emplace_back(this, & g, *ic, t);
+        schedule(& cs.back(), ig->lid);
+        if (i == 1)
+          index_hits(& cs.back());
+      }
+    }
+    ++n;
+  }
+  return n;
+};
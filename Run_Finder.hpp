@@ -7,8 +7,11 @@
 #include "Freq_Setting.hpp"
 #include "DFA_Graph.hpp"
 #include "DFA_Node.hpp"
+#include "Run_Params.hpp"
+#include "Foray_Stats.hpp"
 #include <unordered_map>
 #include <list>
+#include <queue>
 
 typedef std::unordered_map < Lotek_Tag_ID, DFA_Graph > Graph_Map;
 
@@ -17,14 +20,18 @@ typedef std::unordered_map < Lotek_Tag_ID, DFA_Graph > Graph_Map;
 class Run_Foray;
 class Run_Finder;
 class Run_Candidate;
+class Graph_Cache;
 #include "Run_Candidate.hpp"
+#include "Cand_List.hpp"
 
-// Set of running DFAs representing possible tags burst sequences
-typedef std::list < Run_Candidate > Cand_List;
+// Set of running DFAs representing possible tags burst sequences: Cand_List
 
 // Map from Lotek ID to vectors of lists of Run_Candidates
 typedef std::unordered_map < Lotek_Tag_ID, std::vector < Cand_List >  > Cand_List_Map;
 
+// Map from a hit's sequence number to the unconfirmed Run_Candidates holding it
+typedef std::unordered_map < Hit::Seq_No, std::vector < Run_Candidate * > > Hit_Index;
+
 class Run_Finder {
 
   /*
@@ -45,33 +52,78 @@ public:
 
   Nominal_Frequency_kHz nom_freq;
 
-  Graph_Map G;  // a DFA graph for each lotek tag ID at this frequency
+  Graph_Map G;  // a DFA graph for each lotek tag ID at this frequency; with lazy
+  // setup, only those for IDs seen so far are built
+
+  Graph_Cache * graph_cache; // where graphs are mapped from, if anywhere
+
+  Cand_Slab slab; // storage for all run candidates in cands
 
   Cand_List_Map cands; // for each Lotek ID, a list of run candidates; within each list, confirmed
   // candidates precede unconfirmed candidates; within confirmed candidates, order is from earliest
   // to latest confirmed
 
-  // algorithmic parameters
+  // a Lotek ID's candidate lists and graph, from cands and G
+
+  struct ID_Slot {
+    std::vector < Cand_List > * cands;
+    DFA_Graph * graph;
+  };
+
+  // slots for Lotek IDs which are small non-negative integers (as those
+  // of all hits are), indexed by ID, so that each hit finds its lists
+  // and graph without hashing; null for IDs without tags here.  Other
+  // IDs are only in the maps.
+
+  std::vector < ID_Slot > id_slots;
+
+  static const int MAX_SLOT_ID = 4096;
+
+  Hit_Index hit_index; // for each hit held by an unconfirmed candidate (i.e. one on
+  // list 1 or 2 of cands), which candidates hold it; lets a newly-confirmed candidate
+  // find the candidates it conflicts with without scanning the lists
+
+  // when each candidate will become too old, earliest first.  An entry
+  // is added whenever a candidate is made or takes a hit, and is stale
+  // if its candidate has since been destroyed, or has a later deadline.
+  // This lets candidates be expired for Lotek IDs which aren't getting
+  // hits, at a cost per candidate expired.  Only kept when there is an
+  // expiry lag.
+
+  struct Deadline {
+    Timestamp ts;
+    Run_Candidate * cand;
+    Lotek_Tag_ID lid;
+    bool operator> (const Deadline & d) const {return ts > d.ts;};
+  };
+
+  std::priority_queue < Deadline, std::vector < Deadline >, std::greater < Deadline > > deadlines;
+
+  Timestamp watermark; // latest input timestamp seen by advance()
+
+  Gap expiry_lag; // candidates are only expired once the watermark is this far past their deadline;
+  // negative means candidates are only destroyed when a hit for their own ID finds them too old
+
+  // algorithmic parameters, from the Run_Params given to the constructor
 
   Gap burst_slop;	// (seconds) allowed slop in timing between
                         // consecutive tag bursts, in seconds this is
                         // meant to allow for measurement error at tag
                         // registration and detection times
 
-  static Gap default_burst_slop;
-
-
   Gap burst_slop_expansion; // (seconds) how much slop in timing
 			    // between tag bursts increases with each
   // skipped pulse; this is meant to allow for clock drift between
   // the tag and the receiver.
-  static Gap default_burst_slop_expansion;
 
   // how many consecutive bursts can be missing without terminating a
   // run?
 
   unsigned int max_skipped_bursts;
-  static unsigned int default_max_skipped_bursts;
+
+  // how many hits must be seen before a run candidate is confirmed?
+
+  unsigned int hits_to_confirm_id;
 
   // by how many integer seconds can the clock jump (up or down)?
   // .DTA files show evidence of +/-1 s jumps, presumably due
@@ -80,40 +132,122 @@ public:
   // part as-is.  Of course, it could be happening somewhere in
   // the software that generates .DTA files...
 
-  static unsigned int timestamp_wonkiness;
+  unsigned int timestamp_wonkiness;
+
+  // how many candidates can there be for one Lotek ID, and for all IDs
+  // together, before unconfirmed ones are evicted?  0 means no limit.
+  // Under a flood of noise on an ID, this bounds the work done per hit,
+  // which otherwise grows with every hit until candidates get too old.
+
+  unsigned int max_cands_per_id;
+  unsigned int max_cands_total;
+
+  unsigned long long cands_evicted; // how many candidates have been evicted
 
   // output parameters
 
-  static ostream * out_stream;
+  Output_Sink * sink; // where hits from confirmed runs are sent
 
   string prefix;   // prefix before each tag record (e.g. port number then comma)
 
+#ifdef FILTER_TAGS_STATS
+  Foray_Stats stats; // only updated by the thread processing this Run_Finder's hits
+#endif
+
   Run_Finder(Run_Foray * owner);
 
-  Run_Finder(Run_Foray * owner, Nominal_Frequency_kHz nom_freq, string prefix="");
+  Run_Finder(Run_Foray * owner, const Run_Params & params, Nominal_Frequency_kHz nom_freq, string prefix="");
+
+  virtual ~Run_Finder() {};
 
   void add_tag(Known_Tag * t); // add a known tag to this run finder; it will be on the same
                                // frequency as the run finder
 
-  void setup_graphs(); // after all known tags for this frequency have been added, this creates
-  // the corresponding DFA graphs
+  void setup_graphs(Graph_Cache * cache = 0, bool lazy = false); // after all known tags for this frequency
+  // have been added, this creates the corresponding DFA graphs, or maps them from cache where they are
+  // there.  If lazy is true, that is put off until the first hit for each Lotek ID.
 
-  static void set_default_burst_slop_ms(float burst_slop_ms);
+  void build_graph(Lotek_Tag_ID lid, DFA_Graph & g); // create or map the graph g for lid
 
-  static void set_default_burst_slop_expansion_ms(float burst_slop_expansion_ms);
+  DFA_Graph * get_graph(Lotek_Tag_ID lid); // the graph for lid, which must have tags, built if need be
 
-  static void set_default_max_skipped_bursts(unsigned int skip);
+  void set_sink(Output_Sink *sink);
 
-  static void set_out_stream(ostream *os);
+  void init(Graph_Cache * cache = 0, bool lazy = false);
 
-  static void set_timestamp_wonkiness(unsigned int wonk);
+  virtual void process (Hit &h);
 
-  void init();
+  ID_Slot find_slot(Lotek_Tag_ID lid); // lid's slot; its pointers are null if lid has no tags here
 
-  virtual void process (Hit &h);
+  size_t num_candidates(Lotek_Tag_ID lid); // live candidates for lid, by walking its lists
+
+  void index_hit(Hit::Seq_No s, Run_Candidate * c);
+
+  void index_hits(Run_Candidate * c);
+
+  void unindex_hits(Run_Candidate * c);
+
+  void kill_conflicting(Run_Candidate * c, Cand_List & cs);
+
+  void schedule(Run_Candidate * c, Lotek_Tag_ID lid); // note c's current deadline
+
+  void retire(Run_Candidate * c); // end c's run, if any, before it is destroyed for being too old
+
+  // set how far behind the latest input timestamp a hit's timestamp
+  // can be while still being processed exactly as if no candidates
+  // for other IDs had been expired; negative turns expiry across IDs
+  // off.  Default: the Run_Params' expiry_lag.  Only valid before any
+  // hits are processed.
+
+  void set_expiry_lag(Gap lag);
+
+  // note that input has reached watermark, the latest timestamp of
+  // any hit read so far, including those for other Run_Finders; with
+  // an expiry lag, this expires candidates due by watermark less the
+  // lag.  Called before processing each hit, with the watermark as of
+  // that hit, so that which candidates are expired doesn't depend on
+  // how hits are split among Run_Finders.
+
+  void advance(Timestamp watermark);
+
+  // evict the least promising unconfirmed candidates from one Lotek
+  // ID's lists cl, as long as there are more than the budgets allow,
+  // after destroying those too old given a hit at ts.  Only that ID's
+  // candidates are evicted, even when it's the total that is over
+  // budget, as the ID just hit is the one most likely being flooded.
+
+  void enforce_budget(std::vector < Cand_List > & cl, Timestamp ts);
+
+  // destroy candidates which could not accept any hit at watermark
+  // or later, as if such a hit had just been processed.  This is done
+  // by advance(), using the watermark less the expiry lag, and costs
+  // little more than the candidates destroyed.
+
+  void expire(Timestamp watermark);
 
   virtual void end_processing();
 
+  // append the state of this Run_Finder's candidates to groups; only
+  // valid between hits
+
+  void save_state(std::vector < Checkpoint::Group > & groups);
+
+  // recreate the candidates in each group of cp for this Run_Finder's
+  // frequency and Lotek IDs, looking up confirmed tags in tags_by_id.
+  // Returns the number of groups restored.
+
+  unsigned int restore_state(const Checkpoint & cp, const std::unordered_map < string, Known_Tag * > & tags_by_id);
+
+  // call f on each live candidate
+
+  template < typename F >
+  void for_each_candidate(F f) {
+    for (auto cm = cands.begin(); cm != cands.end(); ++cm)
+      for (auto cl = cm->second.begin(); cl != cm->second.end(); ++cl)
+        for (Cand_List::iterator ci = cl->begin(); ci != cl->end(); ++ci)
+          f(*ci);
+  };
+
 };
 
 
@@ -1,87 +1,708 @@
 #include "Run_Foray.hpp"
+#include "Deferred_Sink.hpp"
+#include "Work_Queue.hpp"
+#include "Task_Pool.hpp"
+#include "Checkpoint.hpp"
+#include "Graph_Cache.hpp"
 
 #include <string.h>
+#include <fstream>
+#include <thread>
+#include <memory>
+#include <chrono>
+#include <limits>
 
-Run_Foray::Run_Foray (Tag_Database * tags, std::istream *data, std::ostream *out) :
+Run_Foray::Run_Foray (Tag_Database * tags, Hit_Source *data, Output_Sink *sink) :
   tags(tags),
   data(data),
-  out(out),
-  line_no(0),
-  run_finders()
+  sink(sink),
+  params(),
+  freq_threads(false),
+  num_workers(0),
+  resume_file(),
+  checkpoint_file(),
+  graph_cache_dir(),
+  graph_cache(),
+  shared_graphs(0),
+  lazy_graphs(false),
+  streaming(false),
+  clock_watermark(false),
+  lateness(0),
+  max_latency(1),
+  stats_file(),
+  run_finders(),
+  finders(),
+  freq_finders(),
+  last_freq(std::numeric_limits < Frequency_MHz > ::quiet_NaN()),
+  last_finder(0),
+  input_watermark(0),
+  shards(),
+  shard_maps(),
+  own_codes(),
+  codes(0)
 {
-  
+  set_codes(& own_codes);
 };
 
+Run_Foray::~Run_Foray () {
+  for (auto ir = run_finders.begin(); ir != run_finders.end(); ++ir)
+    delete ir->second;
+};
+
+void
+Run_Foray::set_codes(Hit_Codes * codes) {
+  this->codes = codes;
+  if (data)
+    data->set_codes(codes);
+  if (sink)
+    sink->set_codes(codes);
+};
+
+void
+Run_Foray::set_params(const Run_Params & params) {
+  this->params = params;
+};
+
+void
+Run_Foray::set_freq_threads(bool freq_threads) {
+  this->freq_threads = freq_threads;
+};
+
+void
+Run_Foray::set_num_workers(unsigned int num_workers) {
+  this->num_workers = num_workers;
+};
+
+void
+Run_Foray::set_resume_file(const string & filename) {
+  resume_file = filename;
+};
+
+void
+Run_Foray::set_checkpoint_file(const string & filename) {
+  checkpoint_file = filename;
+};
+
+void
+Run_Foray::set_graph_cache_dir(const string & dir) {
+  graph_cache_dir = dir;
+};
+
+void
+Run_Foray::set_shared_graphs(Graph_Cache * cache) {
+  shared_graphs = cache;
+};
+
+void
+Run_Foray::set_lazy_graphs(bool lazy_graphs) {
+  this->lazy_graphs = lazy_graphs;
+};
+
+void
+Run_Foray::set_stats_file(const string & filename) {
+  stats_file = filename;
+};
+
+void
+Run_Foray::set_streaming(bool clock_watermark, double lateness, double max_latency) {
+  this->streaming = true;
+  this->clock_watermark = clock_watermark;
+  this->lateness = lateness;
+  this->max_latency = max_latency;
+};
+
+size_t
+Run_Foray::peak_candidates() {
+  std::vector < Run_Finder * > rfs = all_finders();
+  size_t n = 0;
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    n += (*ir)->slab.peak();
+  return n;
+};
+
+void
+Run_Foray::request_stop() {
+  stop_requested = 1;
+};
 
 void
 Run_Foray::start() {
+  setup();
+
+  if (streaming)
+    process_stream();
+  else if (num_workers > 0)
+    process_sharded();
+  else if (freq_threads)
+    process_by_freq();
+  else
+    process_serial();
+
+  finish();
+};
+
+void
+Run_Foray::begin() {
+  num_workers = 0;
+  setup();
+};
+
+void
+Run_Foray::push(Hit &h) {
+  if (h.ts > input_watermark)
+    input_watermark = h.ts;
+  Run_Finder * rf = finders[finder_for(h.ant_freq)];
+  rf->advance(input_watermark);
+  rf->process(h);
+};
+
+void
+Run_Foray::setup() {
 
-  // fields in a line
-  double ts;
-  int lid;
-  char ant_label[MAX_ANT_CODE_SIZE+1];
-  int ant_code;
-  unsigned int dtaline; // line number in original .DTA file
-  short sig;
-  double lat;
-  double lon;
-  double freq;
-  Nominal_Frequency_kHz nom_freq;
-  short gain;
-
-  char codeset[MAX_CODESET_SIZE+1];
-  int codeset_id;
+  // streaming doesn't shard, so the run finders made below get the tags
+
+  if (streaming)
+    num_workers = 0;
 
   // add a run finder for each nominal frequency
   Freq_Set nf = tags->get_nominal_freqs();
 
   for (Freq_Set::iterator ifs = nf.begin(); ifs != nf.end(); ++ifs) {
-    Run_Finder * rf = run_finders[*ifs] = new Run_Finder(this, *ifs, "");
+    Run_Finder * rf = run_finders[*ifs] = new Run_Finder(this, params, *ifs, "");
+    finders.push_back(rf);
+    rf->set_sink(sink);
+
+    // hits up to lateness behind the latest are processed exactly
+    if (streaming)
+      rf->set_expiry_lag(lateness);
+
+    // when sharding, tags go to per-Lotek-ID Run_Finders instead, and
+    // this one only sees hits from tags not in the database
+
+    if (num_workers > 0)
+      continue;
     Tag_Set * tgs = tags->get_tags_at_freq(*ifs);
     for (auto it = tgs->begin(); it != tgs->end(); ++it)
       rf->add_tag(*it);
   }
 
-  Run_Finder::set_out_stream(out);
+  // the cache only holds compiled edges
+
+  uint64_t cache_key = 0;
+  string cache_file;
+  Graph_Cache * cache = 0;
+  if (shared_graphs && DFA_Node::use_flat_edges) {
+    cache = shared_graphs;
+  } else if (graph_cache_dir.length() > 0 && DFA_Node::use_flat_edges) {
+    cache_key = Graph_Cache::get_key(tags, params);
+    cache_file = Graph_Cache::get_filename(graph_cache_dir, cache_key);
+    graph_cache.reset(Graph_Cache::open(cache_file, cache_key));
+    cache = graph_cache.get();
+  }
+
+  // a new cache file needs every graph
+
+  bool write_cache = cache_file.length() > 0 && ! graph_cache;
+  bool lazy = lazy_graphs && ! write_cache;
 
   // initialize each run_finder
   for (Freq_Set::iterator ifs = nf.begin(); ifs != nf.end(); ++ifs)
-    run_finders[*ifs]->init();
+    run_finders[*ifs]->init(cache, lazy);
+
+  if (num_workers > 0)
+    setup_shards(cache, lazy);
+
+  if (write_cache)
+    Graph_Cache::write(cache_file, cache_key, all_finders());
+
+  if (resume_file.length() > 0)
+    restore_state();
+};
+
+void
+Run_Foray::finish() {
+  {
+    FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+    sink->flush();
+  }
 
-  for (;;) {
-    // read and parse a line from a .csv file generated by the readDTA.R() function
+  if (checkpoint_file.length() > 0)
+    save_state();
 
-    char buf[MAX_LINE_SIZE + 1];
-    if (! data->getline(buf, MAX_LINE_SIZE)) {
-      if (data->eof())
-        break;
-      data->clear();
+  FT_STAT(report_stats());
+
+  unsigned long long evicted = 0;
+  std::vector < Run_Finder * > rfs = all_finders();
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    evicted += (*ir)->cands_evicted;
+  if (evicted > 0)
+    std::cerr << "Warning: " << evicted << " unconfirmed run candidates were evicted to stay within the candidate budget.\n";
+
+  // runs still open are not dumped, so that with a checkpoint they
+  // can be continued by a later invocation; this just reports IDs not
+  // in the database
+  for (auto rfi = run_finders.begin(); rfi != run_finders.end(); ++rfi)
+    (rfi->second)->end_processing();
+};
+
+unsigned int
+Run_Foray::finder_for(Frequency_MHz freq) {
+  if (freq == last_freq)
+    return last_finder;
+  auto ff = freq_finders.find(freq);
+  if (ff == freq_finders.end()) {
+    Run_Finder_Map::iterator ir = run_finders.find(Freq_Setting::get_closest_nominal_freq(freq, tags->get_nominal_freqs()));
+    if (ir == run_finders.end())
+      throw std::runtime_error("No tag frequency is closest to a hit's antenna frequency (are there no tags, or is it not a number?)");
+    ff = freq_finders.insert(std::make_pair(freq, (unsigned int) std::distance(run_finders.begin(), ir))).first;
+  }
+  last_freq = freq;
+  last_finder = ff->second;
+  return last_finder;
+};
+
+bool
+Run_Foray::next_hit(Hit &h, unsigned int &finder) {
+  FT_STAT(Foray_Stats::Timer parse_timer(stats.parse_ns));
+  if (! data->next(h))
+    return false;
+  if (h.ts > input_watermark)
+    input_watermark = h.ts;
+  finder = finder_for(h.ant_freq);
+  return true;
+};
+
+void
+Run_Foray::process_serial() {
+  Hit h;
+  unsigned int finder;
+
+  while (next_hit(h, finder)) {
+    finders[finder]->advance(input_watermark);
+    finders[finder]->process(h);
+  }
+};
+
+void
+Run_Foray::process_stream() {
+
+  // Process hits as they arrive, for as long as they do.  Between
+  // hits, the Hit_Source may return none for a while (up to
+  // max_latency, for a Follow_Line_Reader); at least that often,
+  // candidates are expired on the watermark less lateness, and
+  // output is flushed.  So memory holds only candidates which could
+  // still accept a hit, and confirmed hits are written within about
+  // max_latency of arriving.
+  //
+  // Expiring a candidate early only makes a difference to output if
+  // a later hit would have been added to it, which can't happen if
+  // later hits are at most lateness behind the watermark.
+
+  Hit h;
+  unsigned int finder;
+  unsigned int hits_since_check = 0;
+  auto last_flush = std::chrono::steady_clock::now();
+
+  while (! stop_requested) {
+    bool got = next_hit(h, finder);
+    if (got) {
+      finders[finder]->advance(input_watermark);
+      finders[finder]->process(h);
+      if (++hits_since_check < CLOCK_CHECK_EVERY)
+        continue;
+    } else if (data->at_end()) {
+      break;
+    }
+    hits_since_check = 0;
+    auto now = std::chrono::steady_clock::now();
+    if (std::chrono::duration < double > (now - last_flush).count() < max_latency)
       continue;
+
+    Timestamp watermark = clock_watermark
+      ? std::chrono::duration < double > (std::chrono::system_clock::now().time_since_epoch()).count()
+      : input_watermark;
+    for (auto rfi = finders.begin(); rfi != finders.end(); ++rfi)
+      (*rfi)->advance(watermark);
+    FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+    sink->flush();
+    last_flush = now;
+  }
+};
+
+void
+Run_Foray::process_by_freq() {
+
+  // Each Run_Finder gets a worker thread which processes batches of
+  // hits from its own queue, recording any output in a Deferred_Sink.
+  // This thread reads and dispatches hits, then merges output batches
+  // back into input order, so that output (including run IDs) is
+  // identical to that from process_serial().  Hits carry sequence
+  // numbers assigned here, in input order.
+
+  // one worker's hits from a batch of input, with the input watermark
+  // as of each hit, and as of the end of the batch
+
+  struct Freq_Batch {
+    std::vector < Hit > hits;
+    std::vector < Timestamp > watermarks;
+    Timestamp end;
+  };
+
+  struct Freq_Worker {
+    Run_Finder * rf;
+    Deferred_Sink sink;
+    Work_Queue < Freq_Batch > in;
+    Work_Queue < Deferred_Sink::Batch > out;
+    std::thread thread;
+
+    Freq_Worker(Run_Finder *rf) :
+      rf(rf),
+      sink(),
+      in(MAX_BATCHES_IN_FLIGHT + 2),
+      out(MAX_BATCHES_IN_FLIGHT + 2)
+    {
+      rf->set_sink(& sink);
+    };
+
+    void run() {
+      Freq_Batch fb;
+      while (in.pop(fb)) {
+        for (size_t i = 0; i < fb.hits.size(); ++i) {
+          sink.begin_hit(fb.hits[i]);
+          rf->advance(fb.watermarks[i]);
+          rf->process(fb.hits[i]);
+        }
+
+        // so candidates expire even if this worker's frequency gets
+        // no more hits; as no hit is processed between this and the
+        // next advance, it doesn't change what is expired by then
+
+        rf->advance(fb.end);
+        Deferred_Sink::Batch b;
+        sink.take(b);
+        out.push(std::move(b));
+      }
+      out.close();
+    };
+  };
+
+  // worker i has finders[i]
+
+  std::vector < std::unique_ptr < Freq_Worker > > workers;
+  for (auto rfi = finders.begin(); rfi != finders.end(); ++rfi)
+    workers.push_back(std::unique_ptr < Freq_Worker > (new Freq_Worker(*rfi)));
+  for (auto iw = workers.begin(); iw != workers.end(); ++iw)
+    (*iw)->thread = std::thread(&Freq_Worker::run, iw->get());
+
+  Deferred_Merger merger(sink, codes);
+  std::vector < Deferred_Sink::Batch > out_batches(workers.size());
+  std::vector < Deferred_Sink::Batch * > out_ptrs;
+  for (auto ib = out_batches.begin(); ib != out_batches.end(); ++ib)
+    out_ptrs.push_back(& *ib);
+
+  // merge the output from the oldest batch still in flight
+
+  auto merge_oldest = [&]() {
+    for (unsigned int i = 0; i < workers.size(); ++i)
+      workers[i]->out.pop(out_batches[i]);
+    FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+    merger.merge(out_ptrs);
+  };
+
+  std::vector < Freq_Batch > pending(workers.size());
+  unsigned int num_pending = 0;
+  unsigned int in_flight = 0;
+
+  auto dispatch = [&]() {
+    for (unsigned int i = 0; i < workers.size(); ++i) {
+      pending[i].end = input_watermark;
+      workers[i]->in.push(std::move(pending[i]));
+      pending[i] = Freq_Batch();
+    }
+    num_pending = 0;
+    if (++in_flight > MAX_BATCHES_IN_FLIGHT) {
+      merge_oldest();
+      --in_flight;
     }
+  };
 
-    if (!buf[0])
-      continue;
+  Hit h;
+  unsigned int finder;
+
+  while (next_hit(h, finder)) {
+    pending[finder].hits.push_back(h);
+    pending[finder].watermarks.push_back(input_watermark);
+    if (++num_pending == HITS_PER_BATCH)
+      dispatch();
+  }
+  if (num_pending > 0)
+    dispatch();
+
+  for (; in_flight > 0; --in_flight)
+    merge_oldest();
+
+  for (auto iw = workers.begin(); iw != workers.end(); ++iw) {
+    (*iw)->in.close();
+    (*iw)->thread.join();
+    (*iw)->rf->set_sink(sink);
+  }
+  finish_deferred(merger);
+};
+
+struct Run_Foray::Shard {
+  Run_Finder rf;
+  Deferred_Sink sink;
+  std::vector < Hit > pending[2]; // hits for the batch being read and the batch being processed
+  std::vector < Timestamp > watermarks[2]; // the input watermark as of each of those hits
+
+  Shard(Run_Foray *owner, Nominal_Frequency_kHz nom_freq) :
+    rf(owner, owner->params, nom_freq, ""),
+    sink()
+  {
+    rf.set_sink(& sink);
+  };
+
+  void process(int which) {
+    std::vector < Hit > & hits = pending[which];
+    for (size_t i = 0; i < hits.size(); ++i) {
+      sink.begin_hit(hits[i]);
+      rf.advance(watermarks[which][i]);
+      rf.process(hits[i]);
+    }
+    hits.clear();
+    watermarks[which].clear();
+  };
+};
+
+void
+Run_Foray::setup_shards(Graph_Cache * cache, bool lazy) {
+
+  // Candidates for different Lotek IDs never interact, so each
+  // (nominal frequency, Lotek ID) pair gets its own Run_Finder, called
+  // a shard here.
+
+  Freq_Set nf = tags->get_nominal_freqs();
+  shard_maps.resize(nf.size());
+  unsigned int i = 0;
+  for (Freq_Set::iterator ifs = nf.begin(); ifs != nf.end(); ++ifs, ++i) {
+    std::unordered_map < Lotek_Tag_ID, Shard * > & sm = shard_maps[i];
+    Tag_Set * tgs = tags->get_tags_at_freq(*ifs);
+    for (auto it = tgs->begin(); it != tgs->end(); ++it) {
+      Shard * & s = sm[(*it)->lid];
+      if (! s) {
+        s = new Shard(this, *ifs);
+        shards.push_back(std::unique_ptr < Shard > (s));
+      }
+      s->rf.add_tag(*it);
+    }
+  }
+
+  // building graphs is independent across shards, too
+
+  Task_Pool pool(num_workers);
+  std::vector < Task_Pool::Task > tasks;
+
+  for (auto is = shards.begin(); is != shards.end(); ++is) {
+    Shard *s = is->get();
+    tasks.push_back([s, cache, lazy]() {s->rf.init(cache, lazy);});
+  }
+  pool.submit(tasks);
+  pool.wait();
+};
+
+void
+Run_Foray::process_sharded() {
+
+  // Each shard (see setup_shards()) with hits in a batch becomes one
+  // task for the pool.  This thread reads hits and groups them by shard,
+  // a batch at a time, so a shard's hits are always processed in
+  // order, by one thread at a time.  While the pool works on one
+  // batch, this thread reads the next.  Output from each batch is
+  // merged back into input order, as in process_by_freq().
+
+  Task_Pool pool(num_workers);
+  std::vector < Task_Pool::Task > tasks;
+
+  Deferred_Merger merger(sink, codes);
+  std::vector < Shard * > touched[2];  // shards with hits in each batch
+  Timestamp batch_end[2] = {0, 0};     // the input watermark at the end of each batch
+  std::vector < Deferred_Sink::Batch > out_batches;
+  std::vector < Deferred_Sink::Batch * > out_ptrs;
+
+  auto launch = [&](int which) {
+    batch_end[which] = input_watermark;
+    for (auto is = touched[which].begin(); is != touched[which].end(); ++is) {
+      Shard *s = *is;
+      tasks.push_back([s, which]() {s->process(which);});
+    }
+    pool.submit(tasks);
+  };
+
+  auto finish = [&](int which) {
+    pool.wait();
+
+    // advance every shard, not just those with hits, so candidates
+    // expire for IDs which get no more hits; no hits after the batch
+    // have been processed, so this doesn't change what is expired
+    // before each of them.  Their output (e.g. ends of runs) is then
+    // merged with the batch's, rather than waiting for a hit.
+
+    std::vector < Shard * > & ts = touched[which];
+    if (params.expiry_lag >= 0) {
+      ts.clear();
+      for (auto is = shards.begin(); is != shards.end(); ++is) {
+        (*is)->rf.advance(batch_end[which]);
+        if (! (*is)->sink.is_empty())
+          ts.push_back(is->get());
+      }
+    }
+    if (out_batches.size() < ts.size())
+      out_batches.resize(ts.size());
+    out_ptrs.clear();
+    for (unsigned int i = 0; i < ts.size(); ++i) {
+      ts[i]->sink.take(out_batches[i]);
+      out_ptrs.push_back(& out_batches[i]);
+    }
+    FT_STAT(Foray_Stats::Timer dump_timer(stats.dump_ns));
+    merger.merge(out_ptrs);
+    ts.clear();
+  };
 
-    ++line_no;
-    // lines are like this:
-    // 1374672755.3166,118,1,45,999,999,1345,166.3,90,"Lotek3"
+  Hit h;
+  unsigned int finder;
+  int cur = 0;           // which batch is being read
+  bool running = false;  // is the other batch being processed?
+  unsigned int num_pending = 0;
 
-    if (9 != sscanf(buf, "%lf,%d,\"%[^\"]\",%hd,%lf,%lf,%u,%lf,%hd\"%[^\"]\"", &ts, &lid, ant_label, &sig, &lat, &lon, &dtaline, &freq, &gain, codeset)) {
-      std::cerr << "Warning: malformed line in input\n  at line " << line_no << ":\n" << (string("") + buf) << std::endl;
+  while (next_hit(h, finder)) {
+    std::unordered_map < Lotek_Tag_ID, Shard * > & sm = shard_maps[finder];
+    auto is = sm.find(h.lid);
+    if (is == sm.end()) {
+      // unknown or bogus ID; nothing will be output, so the
+      // frequency's own Run_Finder can note it right here
+      finders[finder]->advance(input_watermark);
+      finders[finder]->process(h);
       continue;
     }
-    ant_code = Run_Foray::ant_codes.add(std::string(ant_label));
-    nom_freq = Freq_Setting::get_closest_nominal_freq(freq);
-    codeset_id = Run_Foray::codeset_ids.add(std::string(codeset));
+    Shard *s = is->second;
+    if (s->pending[cur].size() == 0)
+      touched[cur].push_back(s);
+    s->pending[cur].push_back(h);
+    s->watermarks[cur].push_back(input_watermark);
+    if (++num_pending == HITS_PER_BATCH) {
+      if (running)
+        finish(1 - cur);
+      launch(cur);
+      running = true;
+      cur = 1 - cur;
+      num_pending = 0;
+    }
+  }
+  if (running)
+    finish(1 - cur);
+  if (num_pending > 0) {
+    launch(cur);
+    finish(cur);
+  }
+  finish_deferred(merger);
+};
 
-    Hit h = Hit::make(ts, lid, ant_code, sig, lat, lon, dtaline, freq, gain, codeset_id);
-    run_finders[nom_freq]->process(h);
+std::vector < Run_Finder * >
+Run_Foray::all_finders() {
+  std::vector < Run_Finder * > rfs;
+  if (shards.size() > 0) {
+    for (auto is = shards.begin(); is != shards.end(); ++is)
+      rfs.push_back(& (*is)->rf);
+  } else {
+    for (auto rfi = run_finders.begin(); rfi != run_finders.end(); ++rfi)
+      rfs.push_back(rfi->second);
   }
+  return rfs;
+};
 
-  // dump any remaining candidates (FIXME: option this once we have resume capability)
-  for (auto rfi = run_finders.begin(); rfi != run_finders.end(); ++rfi)
-    (rfi->second)->end_processing();
+void
+Run_Foray::finish_deferred(Deferred_Merger & merger) {
+  std::vector < Run_Finder * > rfs = all_finders();
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    (*ir)->for_each_candidate([&](Run_Candidate & c) {c.run_id = merger.final_run_id(c.run_id);});
+  sink->set_last_run_id(merger.get_last_run_id());
+};
+
+#ifdef FILTER_TAGS_STATS
+void
+Run_Foray::report_stats() {
+  // when sharding, the per-frequency Run_Finders still see hits
+  // whose IDs have no shard
+
+  Foray_Stats total = stats;
+  std::vector < Run_Finder * > rfs = all_finders();
+  if (shards.size() > 0)
+    for (auto rfi = run_finders.begin(); rfi != run_finders.end(); ++rfi)
+      rfs.push_back(rfi->second);
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    total.add((*ir)->stats);
+
+  if (stats_file.length() == 0) {
+    total.report(std::cerr);
+    return;
+  }
+  std::ofstream out(stats_file.c_str());
+  total.report(out);
+  if (! out.good())
+    std::cerr << "Warning: couldn't write statistics to " << stats_file << std::endl;
+};
+#endif
+
+void
+Run_Foray::restore_state() {
+  Checkpoint cp;
+  cp.read(resume_file);
+  cp.check_params(params);
+
+  // hits refer to antenna and codeset labels by index, so these must
+  // be numbered as before, ahead of any read from the new input
+
+  for (unsigned int i = 0; i < cp.ant_codes.size(); ++i)
+    if (codes->ant_codes.add(cp.ant_codes[i]) != (int) i)
+      throw std::runtime_error("Internal error: antenna codes assigned before restoring checkpoint");
+  for (unsigned int i = 0; i < cp.codeset_ids.size(); ++i)
+    if (codes->codeset_ids.add(cp.codeset_ids[i]) != (int) i)
+      throw std::runtime_error("Internal error: codeset IDs assigned before restoring checkpoint");
+
+  codes->last_seq_no = cp.last_seq_no;
+  sink->set_last_run_id(cp.last_run_id);
+
+  std::unordered_map < string, Known_Tag * > tags_by_id;
+  Freq_Set nf = tags->get_nominal_freqs();
+  for (Freq_Set::iterator ifs = nf.begin(); ifs != nf.end(); ++ifs) {
+    Tag_Set * tgs = tags->get_tags_at_freq(*ifs);
+    for (auto it = tgs->begin(); it != tgs->end(); ++it)
+      tags_by_id[(*it)->fullID] = *it;
+  }
+
+  unsigned int n = 0;
+  std::vector < Run_Finder * > rfs = all_finders();
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    n += (*ir)->restore_state(cp, tags_by_id);
+  if (n != cp.groups.size())
+    throw std::runtime_error("Checkpoint has run candidates for Lotek IDs not in the tag database");
+};
+
+void
+Run_Foray::save_state() {
+  Checkpoint cp;
+  cp.get_params(params);
+  cp.last_seq_no = codes->last_seq_no;
+  cp.last_run_id = sink->get_last_run_id();
+  for (int i = 0; i < codes->ant_codes.size(); ++i)
+    cp.ant_codes.push_back(codes->ant_codes[i]);
+  for (int i = 0; i < codes->codeset_ids.size(); ++i)
+    cp.codeset_ids.push_back(codes->codeset_ids[i]);
+
+  std::vector < Run_Finder * > rfs = all_finders();
+  for (auto ir = rfs.begin(); ir != rfs.end(); ++ir)
+    (*ir)->save_state(cp.groups);
+  cp.write(checkpoint_file);
 };
 
-Hashed_String_Vector Run_Foray::ant_codes = Hashed_String_Vector();
-Hashed_String_Vector Run_Foray::codeset_ids = Hashed_String_Vector();;
+volatile std::sig_atomic_t Run_Foray::stop_requested = 0;
@@ -6,6 +6,15 @@
 #include "Tag_Database.hpp"
 #include "Run_Finder.hpp"
 #include "Hashed_String_Vector.hpp"
+#include "Output_Sink.hpp"
+#include "Hit_Source.hpp"
+#include "Foray_Stats.hpp"
+
+#include <memory>
+#include <csignal>
+
+class Deferred_Merger;
+class Graph_Cache;
 
 /*
   Run_Foray - manager a collection of run finders searching the same data stream.
@@ -18,26 +27,154 @@ class Run_Foray {
 
 public:
   
-  Run_Foray (Tag_Database * tags, std::istream * data, std::ostream * out);
+  Run_Foray (Tag_Database * tags, Hit_Source * data, Output_Sink * sink);
 
-  //  ~Run_Foray ();
+  ~Run_Foray ();
 
   void start();
   Tag_Database * tags; // registered tags on all known nominal frequencies
 
+  // rather than have start() read hits from the Hit_Source, call
+  // begin(), then push() each hit in turn, then finish(), e.g. when
+  // hits are handed over by a caller (see libfilter_tags.h).  Output
+  // is the same as from start() on those hits.  Hits are processed
+  // serially, regardless of set_freq_threads() and set_num_workers().
+
+  void begin();
+
+  void push(Hit &h);
+
+  void finish();
+
+  // label and number hits with codes, which must outlive this foray,
+  // rather than with the foray's own; both the Hit_Source and the
+  // Output_Sink are given it.  Several forays can share codes, as
+  // long as hits are only made with them on one thread (see
+  // Param_Sweep).
+
+  void set_codes(Hit_Codes * codes);
+
+  // the labels and numbering of hits read or pushed
+
+  Hit_Codes * get_codes() {return codes;};
+
+  // find runs using params, rather than the defaults
+
+  void set_params(const Run_Params & params);
+
+  // run each nominal frequency's Run_Finder on its own worker thread?
+  // Output is identical either way.
+
+  void set_freq_threads(bool freq_threads);
+
+  // if num_workers > 0, give each (nominal frequency, Lotek ID) pair its
+  // own Run_Finder, and process these on a work-stealing pool of
+  // num_workers threads.  This takes precedence over freq_threads.
+  // Output is identical either way, unless Run_Params::max_cands_total
+  // is set, as that then limits each pair's candidates separately.
+
+  void set_num_workers(unsigned int num_workers);
+
+  // before processing, restore the state saved in checkpoint file
+  // filename, so that processing continues where that run left off.
+  // The tag database and parameters must be those used then.
+
+  void set_resume_file(const string & filename);
+
+  // after processing, save state to checkpoint file filename
+
+  void set_checkpoint_file(const string & filename);
+
+  // keep compiled DFA graphs in directory dir (see Graph_Cache), using
+  // them instead of building graphs when they are there
+
+  void set_graph_cache_dir(const string & dir);
+
+  // use the compiled DFA graphs in cache, which is shared with other
+  // forays and must outlive this one, rather than building graphs or
+  // using those in a cache directory.  The cache must have been built
+  // from the same tags and parameters (see Graph_Cache::build).
+
+  void set_shared_graphs(Graph_Cache * cache);
+
+  // build the DFA graph for each Lotek ID only when the first hit with
+  // that ID arrives, rather than all of them before processing.
+  // Output is identical either way.  Graphs are still all built up
+  // front when they are to be saved to a new Graph_Cache file.
+
+  void set_lazy_graphs(bool lazy_graphs);
+
+  // treat input as a never-ending stream, as from a live receiver:
+  // see process_stream().  Hits are processed serially, regardless of
+  // set_freq_threads() and set_num_workers().
+  //
+  // - clock_watermark: if true, the watermark is the current time;
+  //   otherwise, it is the latest timestamp seen in the input.
+  //
+  // - lateness: how far (in seconds) behind the watermark a hit's
+  //   timestamp can be while still being processed exactly as it
+  //   would have been without streaming
+  //
+  // - max_latency: output is flushed, and candidates expired, at
+  //   least this often (in seconds)
+
+  void set_streaming(bool clock_watermark, double lateness, double max_latency);
+
+  // when built with FILTER_TAGS_STATS, write statistics (see
+  // Foray_Stats) to filename after processing, rather than to stderr
+
+  void set_stats_file(const string & filename);
+
+  // after start(), the most run candidates each Run_Finder has had at
+  // once, summed over all of them
+
+  size_t peak_candidates();
+
+  // ask a running start() to stop as soon as possible, as if input
+  // had ended; safe to call from a signal handler
+
+  static void request_stop();
+
 protected:
-  static const int MAX_ANT_CODE_SIZE = 5; // max size (chars) of a lotek antenna code
-  static const int MAX_CODESET_SIZE = 32; // max size (chars) of a lotek codeset id
+  // when using worker threads, hits are handed out in batches of this size, and
+  // at most MAX_BATCHES_IN_FLIGHT batches are being processed at any time
+
+  static const unsigned int HITS_PER_BATCH = 8192;
+  static const unsigned int MAX_BATCHES_IN_FLIGHT = 4;
+
   // settings
 
-  std::istream * data; // stream from which data records are read
-  std::ostream * out;  // stream to which tag ID hits are output 
+  Hit_Source * data;   // source from which hits are read
+  Output_Sink * sink;  // where hits from confirmed runs are output
+  Run_Params params;   // parameters for run finding
+  bool freq_threads;   // one worker thread per nominal frequency
+  unsigned int num_workers; // size of thread pool for per-Lotek-ID processing; 0 means none
+  string resume_file;       // checkpoint to restore before processing; empty if none
+  string checkpoint_file;   // checkpoint to save after processing; empty if none
+  string graph_cache_dir;   // directory of Graph_Cache files; empty if none
+  std::unique_ptr < Graph_Cache > graph_cache; // graphs in use from the cache, if any
+  Graph_Cache * shared_graphs; // graphs shared with other forays, if any; not owned
+  bool lazy_graphs;         // build graphs on first hit rather than at start
+  bool streaming;           // input is a never-ending stream
+  bool clock_watermark;     // when streaming, use the clock rather than input timestamps as the watermark
+  double lateness;          // when streaming, seconds by which hits can lag the watermark
+  double max_latency;       // when streaming, maximum seconds between flushes of output
+  string stats_file;        // where to report statistics; empty means stderr
+
+#ifdef FILTER_TAGS_STATS
+  Foray_Stats stats;        // parsing and output merging, which happen on the thread calling start()
+
+  void report_stats();
+#endif
+
+  static volatile std::sig_atomic_t stop_requested;
+
+  // when streaming, the clock is checked after this many hits
+
+  static const unsigned int CLOCK_CHECK_EVERY = 64;
 
   // runtime storage
 
-  // count lines of input seen
-  unsigned long long line_no;
-  
   // we need a Run_Finder for each combination of port and nominal frequency
   // we'll use a map
 
@@ -45,10 +182,72 @@ protected:
 
   Run_Finder_Map run_finders;
 
-public:
+  // the same Run_Finders, in order of nominal frequency, so that a
+  // hit's is found by indexing
+
+  std::vector < Run_Finder * > finders;
+
+  // the index in finders for each antenna frequency seen so far, and
+  // for the latest, so that the closest nominal frequency is only
+  // found once per antenna frequency, not once per hit
+
+  std::unordered_map < Frequency_MHz, unsigned int > freq_finders;
+  Frequency_MHz last_freq;
+  unsigned int last_finder;
+
+  // the latest timestamp of any hit read so far.  Each Run_Finder is
+  // advanced to this as of each hit before processing it, so that
+  // candidates expire the same way whichever threading mode is used.
+
+  Timestamp input_watermark;
+
+  // when num_workers > 0, a Run_Finder for each (nominal frequency, Lotek ID) pair
+
+  struct Shard;
+
+  std::vector < std::unique_ptr < Shard > > shards;
+  std::vector < std::unordered_map < Lotek_Tag_ID, Shard * > > shard_maps; // for each of finders
+
+  // all Run_Finders which can hold candidates
+
+  std::vector < Run_Finder * > all_finders();
+
+  // set up run finders and graphs, and restore any checkpoint
+
+  void setup();
+
+  // the index in finders of the Run_Finder for hits at freq
+
+  unsigned int finder_for(Frequency_MHz freq);
+
+  // get the next valid hit and the index in finders of its Run_Finder,
+  // advancing input_watermark, and returning false at EOF
+
+  bool next_hit(Hit &h, unsigned int &finder);
+
+  void process_serial();
+
+  void process_stream();
+
+  void process_by_freq();
+
+  void setup_shards(Graph_Cache * cache, bool lazy);
+
+  void process_sharded();
+
+  // once a deferred-output mode has merged all its output, make
+  // candidates' run IDs and the sink's run ID counter final
+
+  void finish_deferred(Deferred_Merger & merger);
+
+  void restore_state();
+
+  void save_state();
+
+  // labels and numbering of hits; see set_codes()
 
-  static Hashed_String_Vector ant_codes;
-  static Hashed_String_Vector codeset_ids;
+  Hit_Codes own_codes;
+  Hit_Codes * codes;
 };
 
 
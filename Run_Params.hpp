@@ -0,0 +1,42 @@
+#ifndef RUN_PARAMS_HPP
+#define RUN_PARAMS_HPP
+
+#include "filter_tags_common.hpp"
+
+struct Run_Params {
+
+  // The parameters of the run-finding algorithm.  Each Run_Foray has
+  // its own copy, used by its Run_Finders and their Run_Candidates,
+  // so that forays with different parameters can run side by side
+  // (see Param_Sweep).  See Run_Finder for what each one means.
+
+  Gap           burst_slop;             // seconds
+  Gap           burst_slop_expansion;   // seconds per skipped burst
+  unsigned int  max_skipped_bursts;
+  unsigned int  hits_to_confirm_id;
+  unsigned int  timestamp_wonkiness;
+  unsigned int  max_cands_per_id;       // 0 means no limit
+  unsigned int  max_cands_total;        // 0 means no limit
+  Gap           expiry_lag;             // seconds; negative means no expiry across IDs
+
+  Run_Params() :
+    burst_slop(0.010),                  // 10 ms
+    burst_slop_expansion(0.001),        // 1ms = 1 part in 10000 for 10s BI
+    max_skipped_bursts(60),
+    hits_to_confirm_id(2),              // at least 2 bursts required; choosing 1 would make filtering a NO-OP
+    timestamp_wonkiness(0),
+    max_cands_per_id(0),
+    max_cands_total(0),
+    expiry_lag(-1)
+  {};
+
+  void set_burst_slop_ms(float burst_slop_ms) {
+    burst_slop = burst_slop_ms / 1000.0;        // stored as seconds
+  };
+
+  void set_burst_slop_expansion_ms(float burst_slop_expansion_ms) {
+    burst_slop_expansion = burst_slop_expansion_ms / 1000.0;    // stored as seconds
+  };
+};
+
+#endif // RUN_PARAMS_HPP
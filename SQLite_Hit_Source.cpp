@@ -0,0 +1,119 @@
+#include "SQLite_Hit_Source.hpp"
+
+#include <sstream>
+
+const char * SQLite_Hit_Source::DEFAULT_QUERY = "SELECT ts, id, ant, sig, lat, lon, dtaline, antfreq, gain, codeset FROM hits";
+
+SQLite_Hit_Source::SQLite_Hit_Source(const string & filename, const string & sql) :
+  db(0),
+  sql(sql),
+  query(0),
+  has_codeset(false),
+  row_no(0),
+  last_ant(),
+  last_ant_code(-1)
+{
+  if (sqlite3_open_v2(filename.c_str(), & db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK) {
+    string msg = string("Couldn't open input database ") + filename + ": " + (db ? sqlite3_errmsg(db) : "out of memory");
+    sqlite3_close(db);
+    throw std::runtime_error(msg);
+  }
+  try {
+    // read in large pieces: a big page cache, and mapping the file
+    // where possible rather than reading it page by page
+
+    std::ostringstream pragmas;
+    pragmas << "PRAGMA cache_size = -" << PAGE_CACHE_KB << "; PRAGMA mmap_size = " << MMAP_BYTES;
+    check(sqlite3_exec(db, pragmas.str().c_str(), 0, 0, 0), SQLITE_OK, pragmas.str());
+
+    check(sqlite3_prepare_v2(db, sql.c_str(), -1, & query, 0), SQLITE_OK, sql);
+    int n = sqlite3_column_count(query);
+    if (n < 9 || n > 10)
+      throw std::runtime_error("Input query must return 9 or 10 columns: ts, id, ant, sig, lat, lon, dtaline, antfreq, gain [, codeset]");
+    has_codeset = n == 10;
+  } catch (...) {
+    sqlite3_finalize(query);
+    sqlite3_close(db);
+    throw;
+  }
+};
+
+SQLite_Hit_Source::~SQLite_Hit_Source() {
+  sqlite3_finalize(query);
+  sqlite3_close(db);
+};
+
+std::vector < Frequency_MHz >
+SQLite_Hit_Source::get_ant_freqs() {
+  string q = string("SELECT DISTINCT \"") + sqlite3_column_name(query, 7) + "\" FROM (" + sql + ")";
+  sqlite3_stmt * st = 0;
+  std::vector < Frequency_MHz > freqs;
+  int rv;
+  try {
+    check(sqlite3_prepare_v2(db, q.c_str(), -1, & st, 0), SQLITE_OK, q);
+    while ((rv = sqlite3_step(st)) == SQLITE_ROW)
+      if (sqlite3_column_type(st, 0) != SQLITE_NULL)
+        freqs.push_back(sqlite3_column_double(st, 0));
+    check(rv, SQLITE_DONE, q);
+  } catch (...) {
+    sqlite3_finalize(st);
+    throw;
+  }
+  sqlite3_finalize(st);
+  return freqs;
+};
+
+void
+SQLite_Hit_Source::check(int rv, int ok, const string & what) {
+  if (rv != ok)
+    throw std::runtime_error(string("SQLite error ") + what + ": " + sqlite3_errmsg(db));
+};
+
+bool
+SQLite_Hit_Source::next(Hit &h) {
+  int rv;
+  while ((rv = sqlite3_step(query)) == SQLITE_ROW) {
+    ++row_no;
+
+    int null_col = -1;
+    for (int i = 0; i < 9 && null_col < 0; ++i)
+      if (sqlite3_column_type(query, i) == SQLITE_NULL)
+        null_col = i;
+    if (null_col >= 0) {
+      std::cerr << "Warning: NULL in column " << sqlite3_column_name(query, null_col)
+                << " of input\n  at row " << row_no << std::endl;
+      continue;
+    }
+
+    // the antenna label, interned unless it's the same as last time
+
+    const char * ant = (const char *) sqlite3_column_text(query, 2);
+    int ant_len = sqlite3_column_bytes(query, 2);
+    if (last_ant_code < 0 || last_ant.compare(0, string::npos, ant, ant_len) != 0) {
+      last_ant.assign(ant, ant_len);
+      last_ant_code = codes->ant_codes.add(last_ant);
+    }
+
+    int codeset_id = 0;
+    if (has_codeset) {
+      const char * cs = (const char *) sqlite3_column_text(query, 9);
+      codeset_id = codes->codeset_ids.add(cs ? string(cs, sqlite3_column_bytes(query, 9)) : string(""));
+    } else {
+      codeset_id = codes->codeset_ids.add(string(""));
+    }
+
+    h = Hit::make(codes, sqlite3_column_double(query, 0),
+                  sqlite3_column_int(query, 1),
+                  last_ant_code,
+                  sqlite3_column_int(query, 3),
+                  sqlite3_column_double(query, 4),
+                  sqlite3_column_double(query, 5),
+                  sqlite3_column_int64(query, 6),
+                  sqlite3_column_double(query, 7),
+                  sqlite3_column_int(query, 8),
+                  codeset_id);
+    return true;
+  }
+  check(rv, SQLITE_DONE, "reading input");
+  return false;
+};
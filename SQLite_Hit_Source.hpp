@@ -0,0 +1,59 @@
+#ifndef SQLITE_HIT_SOURCE_HPP
+#define SQLITE_HIT_SOURCE_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Hit_Source.hpp"
+#include "sqlite3.h"
+
+#include <vector>
+
+class SQLite_Hit_Source : public Hit_Source {
+
+  // hits from the rows of a query on an SQLite database.  The query's
+  // columns must be, in order:
+  //
+  //   ts, id, ant, sig, lat, lon, dtaline, antfreq, gain [, codeset]
+  //
+  // as in the .CSV input; ant and codeset are text, the rest numeric.
+  // Rows are stepped through one at a time, with each column read
+  // directly as its native type.  Rows with a NULL in any of the
+  // first nine columns are reported and skipped, like malformed lines
+  // of .CSV input.
+
+protected:
+  static const int PAGE_CACHE_KB = 65536;         // page cache for reading
+  static const long long MMAP_BYTES = 1LL << 30;  // how much of the database file may be mapped
+
+  sqlite3 * db;
+  string sql;
+  sqlite3_stmt * query;
+  bool has_codeset;        // does the query have a codeset column?
+  unsigned long long row_no;
+
+  // the most recent antenna label and its code, to save interning it for every row
+
+  string last_ant;
+  int last_ant_code;
+
+  void check(int rv, int ok, const string & what);
+
+public:
+
+  static const char * DEFAULT_QUERY;
+
+  // open the database in file filename read-only, and prepare
+  // query; throws if this fails
+
+  SQLite_Hit_Source(const string & filename, const string & sql = DEFAULT_QUERY);
+
+  ~SQLite_Hit_Source();
+
+  bool next(Hit &h);
+
+  // the distinct antenna frequencies among all hits the query returns
+
+  std::vector < Frequency_MHz > get_ant_freqs();
+};
+
+#endif // SQLITE_HIT_SOURCE_HPP
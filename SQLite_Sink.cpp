@@ -0,0 +1,231 @@
+#include "SQLite_Sink.hpp"
+
+#include <algorithm>
+
+SQLite_Sink::SQLite_Sink(const string & filename, bool run_summary, bool resume) :
+  db(0),
+  insert_hit(0),
+  update_run(0),
+  insert_run(0),
+  run_set(0),
+  batch(),
+  runs(),
+  runs_changed(),
+  runs_ended(),
+  puts_since_check(0),
+  last_send(std::chrono::steady_clock::now()),
+  queue(MAX_BATCHES_QUEUED),
+  batches_sent(0),
+  batches_written(0),
+  error()
+{
+  if (sqlite3_open_v2(filename.c_str(), & db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, 0) != SQLITE_OK) {
+    string msg = string("Couldn't open output database ") + filename + ": " + (db ? sqlite3_errmsg(db) : "out of memory");
+    sqlite3_close(db);
+    throw std::runtime_error(msg);
+  }
+  try {
+    exec("CREATE TABLE IF NOT EXISTS hits (runSet INTEGER, ts REAL, ant TEXT, id TEXT, runID INTEGER, posInRun INTEGER, sig INTEGER, "
+         "burstSlop REAL, DTAline INTEGER, lat REAL, lon REAL, antFreq REAL, gain INTEGER)");
+    insert_hit = prepare("INSERT INTO hits VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)");
+    run_set = max_run_set("hits");
+    if (run_summary) {
+      exec("CREATE TABLE IF NOT EXISTS runs (runSet INTEGER, runID INTEGER, id TEXT, tsBegin REAL, tsEnd REAL, len INTEGER, "
+           "PRIMARY KEY (runSet, runID))");
+
+      // a run's row is inserted when it is first sent, and later
+      // batches add to it; with resume, that row may have been
+      // inserted by an earlier invocation
+
+      update_run = prepare("UPDATE runs SET tsEnd = ?, len = len + ? WHERE runSet = ? AND runID = ?");
+      insert_run = prepare("INSERT INTO runs VALUES (?, ?, ?, ?, ?, ?)");
+      run_set = std::max(run_set, max_run_set("runs"));
+    }
+    if (! resume || run_set == 0)
+      ++ run_set;
+  } catch (...) {
+    sqlite3_finalize(insert_hit);
+    sqlite3_finalize(update_run);
+    sqlite3_finalize(insert_run);
+    sqlite3_close(db);
+    throw;
+  }
+  batch.rows.reserve(ROWS_PER_TRANSACTION);
+  writer = std::thread(& SQLite_Sink::run_writer, this);
+};
+
+SQLite_Sink::~SQLite_Sink() {
+  try {
+    flush();
+  } catch (std::runtime_error & e) {
+    std::cerr << e.what() << std::endl;
+  }
+  queue.close();
+  writer.join();
+  sqlite3_finalize(insert_hit);
+  sqlite3_finalize(update_run);
+  sqlite3_finalize(insert_run);
+  sqlite3_close(db);
+};
+
+void
+SQLite_Sink::check(int rv, int ok, const char * what) {
+  if (rv != ok)
+    throw std::runtime_error(string("SQLite error ") + what + ": " + sqlite3_errmsg(db));
+};
+
+void
+SQLite_Sink::exec(const char * sql) {
+  check(sqlite3_exec(db, sql, 0, 0, 0), SQLITE_OK, sql);
+};
+
+long long
+SQLite_Sink::max_run_set(const char * table) {
+  // the largest runSet in table, or 0 if it is empty
+
+  sqlite3_stmt * st = prepare((string("SELECT max(runSet) FROM ") + table).c_str());
+  long long rs = 0;
+  if (sqlite3_step(st) == SQLITE_ROW)
+    rs = sqlite3_column_int64(st, 0);
+  sqlite3_finalize(st);
+  return rs;
+};
+
+sqlite3_stmt *
+SQLite_Sink::prepare(const char * sql) {
+  sqlite3_stmt * st = 0;
+  check(sqlite3_prepare_v2(db, sql, -1, & st, 0), SQLITE_OK, sql);
+  return st;
+};
+
+void
+SQLite_Sink::put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+  Row r = {h.ts, codes->ant_codes[h.ant_code], tag, run_id, pos_in_run, h.sig, burst_slop, h.dtaline, h.lat, h.lon, h.ant_freq, h.gain};
+  batch.rows.push_back(r);
+
+  if (update_run) {
+    auto ri = runs.find(run_id);
+    if (ri == runs.end()) {
+      Run_Summary s = {tag, h.ts, h.ts, 1};
+      runs[run_id] = s;
+    } else {
+      ri->second.ts_end = h.ts;
+      ++ ri->second.len;
+    }
+    runs_changed.insert(run_id);
+  }
+
+  if (batch.rows.size() >= ROWS_PER_TRANSACTION) {
+    send_batch();
+  } else if (++puts_since_check == CLOCK_CHECK_EVERY) {
+    puts_since_check = 0;
+    if (std::chrono::duration < double > (std::chrono::steady_clock::now() - last_send).count() >= MAX_FLUSH_DELAY)
+      send_batch();
+  }
+};
+
+void
+SQLite_Sink::end_run(unsigned long long run_id) {
+  if (update_run)
+    runs_ended.push_back(run_id);
+};
+
+void
+SQLite_Sink::send_batch() {
+  // hand the current batch to the writer thread
+
+  for (auto ic = runs_changed.begin(); ic != runs_changed.end(); ++ic) {
+    Run_Summary & s = runs[*ic];
+    batch.runs.push_back(std::make_pair(*ic, s));
+    s.len = 0;
+  }
+  runs_changed.clear();
+  for (auto ie = runs_ended.begin(); ie != runs_ended.end(); ++ie)
+    runs.erase(*ie);
+  runs_ended.clear();
+
+  {
+    std::unique_lock < std::mutex > lock(m);
+    ++ batches_sent;
+  }
+  queue.push(std::move(batch));
+  batch = Batch();
+  batch.rows.reserve(ROWS_PER_TRANSACTION);
+  puts_since_check = 0;
+  last_send = std::chrono::steady_clock::now();
+};
+
+void
+SQLite_Sink::flush() {
+  if (batch.rows.size() > 0)
+    send_batch();
+  std::unique_lock < std::mutex > lock(m);
+  batch_done.wait(lock, [this]{return batches_written == batches_sent;});
+  if (error.length() > 0)
+    throw std::runtime_error(error);
+};
+
+void
+SQLite_Sink::write_batch(Batch & b) {
+  // insert one batch in a single transaction
+
+  exec("BEGIN");
+  for (auto ir = b.rows.begin(); ir != b.rows.end(); ++ir) {
+    sqlite3_bind_int64(insert_hit, 1, run_set);
+    sqlite3_bind_double(insert_hit, 2, ir->ts);
+    sqlite3_bind_text(insert_hit, 3, ir->ant.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_text(insert_hit, 4, ir->tag->fullID.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_int64(insert_hit, 5, ir->run_id);
+    sqlite3_bind_int(insert_hit, 6, ir->pos_in_run);
+    sqlite3_bind_int(insert_hit, 7, ir->sig);
+    sqlite3_bind_double(insert_hit, 8, ir->burst_slop);
+    sqlite3_bind_int64(insert_hit, 9, ir->dtaline);
+    sqlite3_bind_double(insert_hit, 10, ir->lat);
+    sqlite3_bind_double(insert_hit, 11, ir->lon);
+    sqlite3_bind_double(insert_hit, 12, ir->ant_freq);
+    sqlite3_bind_int(insert_hit, 13, ir->gain);
+    check(sqlite3_step(insert_hit), SQLITE_DONE, "inserting hit");
+    sqlite3_reset(insert_hit);
+  }
+  for (auto iu = b.runs.begin(); iu != b.runs.end(); ++iu) {
+    sqlite3_bind_double(update_run, 1, iu->second.ts_end);
+    sqlite3_bind_int(update_run, 2, iu->second.len);
+    sqlite3_bind_int64(update_run, 3, run_set);
+    sqlite3_bind_int64(update_run, 4, iu->first);
+    check(sqlite3_step(update_run), SQLITE_DONE, "updating run");
+    sqlite3_reset(update_run);
+    if (sqlite3_changes(db) > 0)
+      continue;
+    sqlite3_bind_int64(insert_run, 1, run_set);
+    sqlite3_bind_int64(insert_run, 2, iu->first);
+    sqlite3_bind_text(insert_run, 3, iu->second.tag->fullID.c_str(), -1, SQLITE_STATIC);
+    sqlite3_bind_double(insert_run, 4, iu->second.ts_begin);
+    sqlite3_bind_double(insert_run, 5, iu->second.ts_end);
+    sqlite3_bind_int(insert_run, 6, iu->second.len);
+    check(sqlite3_step(insert_run), SQLITE_DONE, "inserting run");
+    sqlite3_reset(insert_run);
+  }
+  exec("COMMIT");
+};
+
+void
+SQLite_Sink::run_writer() {
+  // body of the writer thread.  After an error, later batches are
+  // discarded; the error is reported by the next flush().
+
+  Batch b;
+  while (queue.pop(b)) {
+    if (error.length() == 0) {
+      try {
+        write_batch(b);
+      } catch (std::runtime_error & e) {
+        sqlite3_exec(db, "ROLLBACK", 0, 0, 0);
+        std::unique_lock < std::mutex > lock(m);
+        error = e.what();
+      }
+    }
+    std::unique_lock < std::mutex > lock(m);
+    ++ batches_written;
+    batch_done.notify_all();
+  }
+};
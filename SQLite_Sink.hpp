@@ -0,0 +1,118 @@
+#ifndef SQLITE_SINK_HPP
+#define SQLITE_SINK_HPP
+
+#include "filter_tags_common.hpp"
+
+#include "Output_Sink.hpp"
+#include "Work_Queue.hpp"
+#include "sqlite3.h"
+
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <unordered_map>
+
+class SQLite_Sink : public Output_Sink {
+
+  // write hits into table "hits" of an SQLite database, with the same
+  // columns as the .CSV output, and optionally maintain a per-run
+  // summary in table "runs".  Run IDs restart with each invocation
+  // (unless it resumes from a checkpoint), so both tables begin with
+  // column runSet, numbering the invocations which wrote to the
+  // database; a run is identified by (runSet, runID).  Rows are collected into batches of
+  // ROWS_PER_TRANSACTION (or whatever has accumulated after
+  // MAX_FLUSH_DELAY seconds), and each batch is inserted in a single
+  // transaction on a writer thread, so that run finding never waits
+  // on the disk.  The prefix passed to put() is not recorded.
+  //
+  // With a run summary, each run's row is kept in memory from its
+  // first hit until end_run(), so memory grows with the number of
+  // runs open at once; runs never ended (e.g. still open when input
+  // ends) stay until the sink is destroyed.
+
+protected:
+  static const size_t ROWS_PER_TRANSACTION = 50000;
+  static const size_t MAX_BATCHES_QUEUED = 4;
+  static const unsigned CLOCK_CHECK_EVERY = 64; // puts between looks at the clock
+  static constexpr double MAX_FLUSH_DELAY = 1.0;
+
+  struct Row {
+    double              ts;
+    string              ant;
+    Known_Tag          *tag;
+    unsigned long long  run_id;
+    unsigned int        pos_in_run;
+    short               sig;
+    double              burst_slop;
+    unsigned int        dtaline;
+    float               lat;
+    float               lon;
+    double              ant_freq;
+    short               gain;
+  };
+
+  struct Run_Summary {
+    Known_Tag          *tag;
+    double              ts_begin;   // timestamp of first hit output
+    double              ts_end;     // timestamp of last hit output
+    unsigned int        len;        // number of hits output since the run was last sent
+  };
+
+  struct Batch {
+    std::vector < Row > rows;
+    std::vector < std::pair < unsigned long long, Run_Summary > > runs; // runs changed by rows
+  };
+
+  sqlite3 * db;
+  sqlite3_stmt * insert_hit;
+  sqlite3_stmt * update_run;  // 0 unless a run summary was requested
+  sqlite3_stmt * insert_run;  // 0 unless a run summary was requested
+  long long run_set;          // value of runSet for everything written
+
+  Batch batch;  // being filled by put()
+  std::unordered_map < unsigned long long, Run_Summary > runs; // runs seen and not yet ended
+  std::unordered_set < unsigned long long > runs_changed; // runs changed since batch was last sent
+  std::vector < unsigned long long > runs_ended; // runs to forget once their last change has been sent
+
+  unsigned puts_since_check;
+  std::chrono::steady_clock::time_point last_send;
+
+  // the writer thread, and what the main thread needs to know about its progress
+
+  Work_Queue < Batch > queue;
+  std::thread writer;
+  std::mutex m;
+  std::condition_variable batch_done;
+  unsigned long long batches_sent;
+  unsigned long long batches_written;
+  string error;  // first error from the writer thread; empty if none
+
+  void exec(const char * sql);
+  sqlite3_stmt * prepare(const char * sql);
+  void check(int rv, int ok, const char * what);
+  long long max_run_set(const char * table);
+  void send_batch();
+  void write_batch(Batch & b);
+  void run_writer();
+
+public:
+
+  // open (creating if necessary) the database in file filename;
+  // throws if this fails.  Output goes to a new run set, or with
+  // resume, to the latest one, as run IDs continue from it.
+
+  SQLite_Sink(const string & filename, bool run_summary, bool resume);
+
+  ~SQLite_Sink();
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop);
+
+  void end_run(unsigned long long run_id);
+
+  // wait until everything put so far has been committed; throws if
+  // the writer thread has failed
+
+  void flush();
+};
+
+#endif // SQLITE_SINK_HPP
@@ -1,42 +1,174 @@
 #include "Tag_Database.hpp"
+#include "Line_Reader.hpp"
+#include "sqlite3.h"
+
 #include <sstream>
+#include <memory>
+#include <stdlib.h>
+#include <string.h>
+
+const char * Tag_Database::DEFAULT_QUERY = "SELECT proj, id, tagFreq, bi FROM tags";
+
+// parse a line "proj",id,tagFreq,bi, as sscanf with format
+// "\"%[^\"]\",%f,%f,%f" would; returns false if sscanf would not
+// have matched all four
+
+static bool
+parse_tag_line(const char * buf, string & proj, float & id, float & freq_MHz, float & bi) {
+  if (buf[0] != '"')
+    return false;
+  const char * q = strchr(buf + 1, '"');
+  if (! q || q == buf + 1)
+    return false;
+  proj.assign(buf + 1, q - buf - 1);
+  const char * p = q + 1;
+  float * f[3] = {& id, & freq_MHz, & bi};
+  for (int i = 0; i < 3; ++i) {
+    if (*p != ',')
+      return false;
+    ++p;
+    char * e;
+    *f[i] = strtof(p, & e);
+    if (e == p)
+      return false;
+    p = e;
+  }
+  return true;
+};
 
 Tag_Database::Tag_Database(string filename) {
 
-  ifstream inf(filename.c_str(), ifstream::in);
+  std::unique_ptr < Line_Reader > lines(Line_Reader::open(filename));
+  const char * line;
+  size_t len;
   char buf[MAX_LINE_SIZE + 1];
 
-  inf.getline(buf, MAX_LINE_SIZE);
-  if (string(buf) != "\"proj\",\"id\",\"tagFreq\",\"bi\"")
+  // as when lines were read with istream::getline into a buffer of
+  // MAX_LINE_SIZE characters, an overly long line is truncated, and
+  // ends the input
+
+  bool too_long = false;
+  auto get_line = [&]() {
+    if (too_long || ! lines->next_line(line, len))
+      return false;
+    if (len > MAX_LINE_SIZE - 1) {
+      len = MAX_LINE_SIZE - 1;
+      too_long = true;
+    }
+    memcpy(buf, line, len);
+    buf[len] = 0;
+    return true;
+  };
+
+  if (! get_line() || string(buf) != "\"proj\",\"id\",\"tagFreq\",\"bi\"")
     throw std::runtime_error("Tag file header missing or incorrect\n");
 
+  std::vector < Tag_Row > rows;
+  string proj;
+  const string * last_proj = 0;
+
   int num_lines = 1;
-  while (! inf.eof()) {
-    inf.getline(buf, MAX_LINE_SIZE);
-    if (inf.gcount() == 0)
-      break;
-    char proj[MAX_LINE_SIZE+1];
-    Lotek_Tag_ID id;
-    float freq_MHz;
-    float bi;
-
-    int num_par = sscanf(buf, "\"%[^\"]\",%f,%f,%f", proj, &id, &freq_MHz, &bi);
-    if (num_par < 4) {
+  while (get_line()) {
+    Tag_Row r;
+    if (! parse_tag_line(buf, proj, r.id, r.freq_MHz, r.bi)) {
+      // let sscanf say how far it gets
+      char sproj[MAX_LINE_SIZE+1];
+      int num_par = sscanf(buf, "\"%[^\"]\",%f,%f,%f", sproj, &r.id, &r.freq_MHz, &r.bi);
       std::ostringstream msg;
       msg << "Tag database file incomplete or corrupt at line " << (num_lines+1) << ", with only " << num_par << " parameters parsed successfully.\n";
       throw std::runtime_error(msg.str());
     }
     ++ num_lines;
-    Nominal_Frequency_kHz nom_freq = Freq_Setting::as_Nominal_Frequency_kHz(freq_MHz);
 
-    if (nominal_freqs.count(nom_freq) == 0) {
-      // we haven't seen this nominal frequency before
-      // add it to the list and create a place to hold stuff
-      nominal_freqs.insert(nom_freq);
-      tags[nom_freq] = Tag_Set();
-    }
-    tags[nom_freq].insert (new Known_Tag (id, string(proj), nom_freq, bi));
+    // tags from a project usually come together, so only intern the
+    // project name when it changes
+
+    if (! last_proj || *last_proj != proj)
+      last_proj = Known_Tag::intern_proj(proj);
+    r.proj = last_proj;
+    rows.push_back(r);
   };
+  add_tags(rows);
+};
+
+Tag_Database::Tag_Database(const string & db_filename, const string & query, const std::vector < Frequency_MHz > * hit_freqs) {
+  sqlite3 * db = 0;
+  sqlite3_stmt * st = 0;
+  std::vector < Tag_Row > rows;
+
+  try {
+    if (sqlite3_open_v2(db_filename.c_str(), & db, SQLITE_OPEN_READONLY, 0) != SQLITE_OK)
+      throw std::runtime_error(string("Couldn't open tag database ") + db_filename + ": " + (db ? sqlite3_errmsg(db) : "out of memory"));
+    if (sqlite3_prepare_v2(db, query.c_str(), -1, & st, 0) != SQLITE_OK)
+      throw std::runtime_error(string("SQLite error ") + query + ": " + sqlite3_errmsg(db));
+    if (sqlite3_column_count(st) != 4)
+      throw std::runtime_error("Tag query must return 4 columns: proj, id, tagFreq, bi");
+
+    string proj;
+    const string * last_proj = 0;
+    int rv;
+    while ((rv = sqlite3_step(st)) == SQLITE_ROW) {
+      for (int i = 0; i < 4; ++i)
+        if (sqlite3_column_type(st, i) == SQLITE_NULL)
+          throw std::runtime_error(string("NULL in column ") + sqlite3_column_name(st, i) + " of tag database");
+      proj.assign((const char *) sqlite3_column_text(st, 0), sqlite3_column_bytes(st, 0));
+      if (! last_proj || *last_proj != proj)
+        last_proj = Known_Tag::intern_proj(proj);
+      Tag_Row r = {last_proj, (Lotek_Tag_ID) sqlite3_column_double(st, 1), (float) sqlite3_column_double(st, 2), (float) sqlite3_column_double(st, 3)};
+      rows.push_back(r);
+    }
+    if (rv != SQLITE_DONE)
+      throw std::runtime_error(string("SQLite error reading tags: ") + sqlite3_errmsg(db));
+  } catch (...) {
+    sqlite3_finalize(st);
+    sqlite3_close(db);
+    throw;
+  }
+  sqlite3_finalize(st);
+  sqlite3_close(db);
+
+  if (hit_freqs) {
+    // keep only tags on a nominal frequency which some hit will be
+    // assigned to.  As every hit's closest nominal frequency is kept,
+    // hits are assigned exactly as they would be with all tags.
+
+    Freq_Set all_freqs;
+    for (auto ir = rows.begin(); ir != rows.end(); ++ir)
+      all_freqs.insert(Freq_Setting::as_Nominal_Frequency_kHz(ir->freq_MHz));
+    Freq_Set used;
+    for (auto ih = hit_freqs->begin(); ih != hit_freqs->end(); ++ih)
+      used.insert(Freq_Setting::get_closest_nominal_freq(*ih, all_freqs));
+
+    std::vector < Tag_Row > kept;
+    for (auto ir = rows.begin(); ir != rows.end(); ++ir)
+      if (used.count(Freq_Setting::as_Nominal_Frequency_kHz(ir->freq_MHz)))
+        kept.push_back(*ir);
+    rows.swap(kept);
+  }
+  add_tags(rows);
+};
+
+Tag_Database::Tag_Database(const std::vector < Tag_Row > & rows) {
+  add_tags(rows);
+};
+
+void
+Tag_Database::add_tags(const std::vector < Tag_Row > & rows) {
+  // create all the Known_Tags in one block, in the order read; only
+  // once it has been filled are pointers to them taken
+
+  std::unordered_set < std::string > full_ids;
+  tag_store.reserve(rows.size());
+  for (auto ir = rows.begin(); ir != rows.end(); ++ir) {
+    tag_store.push_back(Known_Tag(ir->id, ir->proj, Freq_Setting::as_Nominal_Frequency_kHz(ir->freq_MHz), ir->bi));
+    tag_store.back().make_unique(full_ids);
+  }
+
+  for (auto it = tag_store.begin(); it != tag_store.end(); ++it) {
+    // the first tag seen on a nominal frequency creates its Tag_Set
+    nominal_freqs.insert(it->freq);
+    tags[it->freq].insert(& *it);
+  }
   if (tags.size() == 0)
     throw std::runtime_error("No tags registered.");
 };
@@ -7,24 +7,59 @@
 #include "Known_Tag.hpp"
 
 #include <map>
+#include <vector>
 
 class Tag_Database {
 
  private:
   typedef std::map < Nominal_Frequency_kHz, Tag_Set > Tag_Set_Set;
   
+  std::vector < Known_Tag > tag_store; // all tags, in the order read
+
   Tag_Set_Set tags;
 
   Freq_Set nominal_freqs;
 
 public:
+  // a tag as read, before it is made into a Known_Tag
+
+  struct Tag_Row {
+    const string * proj;   // from Known_Tag::intern_proj()
+    Lotek_Tag_ID id;
+    float freq_MHz;
+    float bi;
+  };
+
+private:
+  void add_tags(const std::vector < Tag_Row > & rows);
+
+public:
+  // the tags in rows, e.g. as given through libfilter_tags
+
+  Tag_Database (const std::vector < Tag_Row > & rows);
+
+  // read tags from a .CSV file with lines "proj",id,tagFreq,bi
+
   Tag_Database (string filename);
 
+  // read tags from an SQLite database, as the rows of query, whose
+  // columns must be proj, id, tagFreq, bi.  If hit_freqs is not null,
+  // only tags on the nominal frequencies closest to those antenna
+  // frequencies are kept.
+
+  Tag_Database (const string & db_filename, const string & query, const std::vector < Frequency_MHz > * hit_freqs = 0);
+
+  static const char * DEFAULT_QUERY;
+
   Freq_Set & get_nominal_freqs();
 
   Tag_Set * get_tags_at_freq(Nominal_Frequency_kHz freq);
 
   Known_Tag * get_tag(Tag_ID id);
+
+  // the position of tag t in the order tags were read
+
+  size_t index_of(const Known_Tag * t) {return t - tag_store.data();};
 };
 
 #endif // TAG_DATABASE_HPP
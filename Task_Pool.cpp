@@ -0,0 +1,123 @@
+#include "Task_Pool.hpp"
+
+Task_Pool::Task_Pool(unsigned int num_threads) :
+  deques(),
+  threads(),
+  unfinished(0),
+  stopping(false),
+  error(),
+  queued(0),
+  next_deque(0)
+{
+  if (num_threads == 0)
+    num_threads = 1;
+  for (unsigned int i = 0; i < num_threads; ++i)
+    deques.push_back(std::unique_ptr < Task_Deque > (new Task_Deque()));
+  for (unsigned int i = 0; i < num_threads; ++i)
+    threads.push_back(std::thread(&Task_Pool::work, this, i));
+};
+
+Task_Pool::~Task_Pool() {
+  {
+    std::unique_lock < std::mutex > lock(m);
+    stopping = true;
+    work_available.notify_all();
+  }
+  for (auto it = threads.begin(); it != threads.end(); ++it)
+    it->join();
+};
+
+unsigned int
+Task_Pool::size() {
+  return threads.size();
+};
+
+bool
+Task_Pool::take(unsigned int i, Task &t) {
+  // try our own deque first, newest task first
+
+  {
+    Task_Deque &d = *deques[i];
+    std::unique_lock < std::mutex > lock(d.m);
+    if (d.tasks.size() > 0) {
+      t = std::move(d.tasks.back());
+      d.tasks.pop_back();
+      --queued;
+      return true;
+    }
+  }
+
+  // steal the oldest task from someone else
+
+  for (unsigned int k = 1; k < deques.size(); ++k) {
+    Task_Deque &d = *deques[(i + k) % deques.size()];
+    std::unique_lock < std::mutex > lock(d.m);
+    if (d.tasks.size() > 0) {
+      t = std::move(d.tasks.front());
+      d.tasks.pop_front();
+      --queued;
+      return true;
+    }
+  }
+  return false;
+};
+
+void
+Task_Pool::work(unsigned int i) {
+  for (;;) {
+    Task t;
+    if (take(i, t)) {
+      std::exception_ptr e;
+      try {
+        t();
+      } catch (...) {
+        e = std::current_exception();
+      }
+      std::unique_lock < std::mutex > lock(m);
+      if (e && ! error)
+        error = e;
+      if (--unfinished == 0)
+        all_done.notify_all();
+      continue;
+    }
+    std::unique_lock < std::mutex > lock(m);
+    work_available.wait(lock, [this]{return stopping || queued > 0;});
+    if (stopping)
+      return;
+  }
+};
+
+void
+Task_Pool::submit(std::vector < Task > & tasks) {
+  if (tasks.size() == 0)
+    return;
+  {
+    std::unique_lock < std::mutex > lock(m);
+    unfinished += tasks.size();
+    queued += tasks.size();
+  }
+
+  // deal tasks out round-robin; stealing evens out any imbalance
+
+  for (auto it = tasks.begin(); it != tasks.end(); ++it) {
+    Task_Deque &d = *deques[next_deque];
+    next_deque = (next_deque + 1) % deques.size();
+    std::unique_lock < std::mutex > lock(d.m);
+    d.tasks.push_back(std::move(*it));
+  }
+  tasks.clear();
+
+  std::unique_lock < std::mutex > lock(m);
+  work_available.notify_all();
+};
+
+void
+Task_Pool::wait() {
+  std::unique_lock < std::mutex > lock(m);
+  all_done.wait(lock, [this]{return unfinished == 0;});
+  if (error) {
+    std::exception_ptr e = error;
+    error = std::exception_ptr();
+    std::rethrow_exception(e);
+  }
+};
@@ -0,0 +1,67 @@
+#ifndef TASK_POOL_HPP
+#define TASK_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <exception>
+
+class Task_Pool {
+
+  // A fixed set of worker threads, each with its own deque of tasks.
+  // A worker takes tasks from the back of its own deque; when that is
+  // empty it steals from the front of another worker's deque.
+  // Tasks are submitted in groups, and wait() returns once every
+  // submitted task has finished.  An exception thrown by a task is
+  // rethrown by wait() on the submitting thread.
+
+public:
+  typedef std::function < void () > Task;
+
+protected:
+  struct Task_Deque {
+    std::mutex m;
+    std::deque < Task > tasks;
+  };
+
+  std::vector < std::unique_ptr < Task_Deque > > deques;
+  std::vector < std::thread > threads;
+
+  std::mutex m;                  // protects the following, and guards sleeping
+  std::condition_variable work_available;
+  std::condition_variable all_done;
+  size_t unfinished;             // tasks submitted but not yet finished
+  bool stopping;
+  std::exception_ptr error;      // first exception thrown by a task since the last wait()
+
+  std::atomic < size_t > queued; // tasks submitted but not yet taken by a worker
+  unsigned int next_deque;       // where submit() places the next task
+
+  bool take(unsigned int i, Task &t);
+
+  void work(unsigned int i);
+
+public:
+
+  Task_Pool(unsigned int num_threads);
+
+  ~Task_Pool();
+
+  unsigned int size();
+
+  // queue tasks for execution; tasks is left empty
+
+  void submit(std::vector < Task > & tasks);
+
+  // wait until all submitted tasks have finished; if any of them
+  // threw, rethrow the first exception
+
+  void wait();
+};
+
+#endif // TASK_POOL_HPP
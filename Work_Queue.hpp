@@ -0,0 +1,58 @@
+#ifndef WORK_QUEUE_HPP
+#define WORK_QUEUE_HPP
+
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+// a bounded, blocking, first-in first-out queue for passing work
+// between threads.  push() waits while the queue is full; pop() waits
+// while it is empty, and returns false once the queue has been closed
+// and drained.
+
+template < typename T >
+class Work_Queue {
+
+protected:
+  std::deque < T > q;
+  size_t capacity;
+  bool closed;
+  std::mutex m;
+  std::condition_variable not_empty;
+  std::condition_variable not_full;
+
+public:
+
+  Work_Queue(size_t capacity = 4) :
+    q(),
+    capacity(capacity),
+    closed(false)
+  {
+  };
+
+  void push(T && x) {
+    std::unique_lock < std::mutex > lock(m);
+    not_full.wait(lock, [this]{return q.size() < capacity;});
+    q.push_back(std::move(x));
+    not_empty.notify_one();
+  };
+
+  bool pop(T & x) {
+    std::unique_lock < std::mutex > lock(m);
+    not_empty.wait(lock, [this]{return closed || q.size() > 0;});
+    if (q.size() == 0)
+      return false;
+    x = std::move(q.front());
+    q.pop_front();
+    not_full.notify_one();
+    return true;
+  };
+
+  void close() {
+    std::unique_lock < std::mutex > lock(m);
+    closed = true;
+    not_empty.notify_all();
+  };
+};
+
+#endif // WORK_QUEUE_HPP
@@ -0,0 +1,545 @@
+/*
+
+  bench_filter_tags: time filter_tags on a synthetic workload
+
+  Generates a registry of tags and a stream of hits from them, plus
+  background noise, from a seed, so that the same options always
+  give the same workload.  Then times parsing, run finding end to
+  end, and a few inner operations, printing results as JSON on
+  stdout.  With --output, just writes the workload as a tag database
+  and a hits file which filter_tags can read.
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+*/
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <getopt.h>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "filter_tags_common.hpp"
+#include "Freq_Setting.hpp"
+#include "Tag_Database.hpp"
+#include "Hit.hpp"
+#include "Run_Candidate.hpp"
+#include "Run_Finder.hpp"
+#include "Run_Foray.hpp"
+#include "Cand_List.hpp"
+#include "CSV_Hit_Source.hpp"
+#include "Line_Reader.hpp"
+
+void
+usage() {
+  puts (
+	"Usage:\n"
+	"    bench_filter_tags [OPTIONS]\n\n"
+
+	"Generates a synthetic tag database and hit stream, times filter_tags on\n"
+	"them, and prints the results as JSON.  OPTIONS can be any of:\n\n"
+
+	"-s, --seed=N\n"
+	"    seed for the workload; the same options and seed always give the\n"
+	"    same workload.  default: 1\n\n"
+
+	"-F, --freqs=N\n"
+	"    number of nominal frequencies.  default: 2\n\n"
+
+	"-l, --lids=N\n"
+	"    number of Lotek IDs per nominal frequency.  default: 50\n\n"
+
+	"-k, --tags-per-lid=N\n"
+	"    number of registered tags sharing each Lotek ID.  default: 2\n\n"
+
+	"-b, --bi=SECS\n"
+	"    mean burst interval.  default: 10\n\n"
+
+	"-B, --bi-spread=SECS\n"
+	"    burst intervals are uniform within this of the mean.  default: 5\n\n"
+
+	"-p, --detect-prob=P\n"
+	"    probability that each burst of an active tag is detected.  default: 0.7\n\n"
+
+	"-t, --wonkiness=N\n"
+	"    if positive, 5% of hits have their timestamp stepped by a whole number\n"
+	"    of seconds, up to N either way, as by a receiver clock being set.\n"
+	"    default: 0\n\n"
+
+	"-n, --noise-rate=HZ\n"
+	"    rate of background hits with random IDs, some not registered.\n"
+	"    default: 0.5\n\n"
+
+	"-d, --duration=SECS\n"
+	"    length of the hit stream.  default: 86400\n\n"
+
+	"-c, --cand-hits=N\n"
+	"    hits held by the candidates used for the clone and shared-hit\n"
+	"    timings.  default: 3\n\n"
+
+	"-r, --reps=N\n"
+	"    report the best of N repetitions of each timing.  default: 3\n\n"
+
+	"-o, --output=PREFIX\n"
+	"    only write the workload, to PREFIX.tags and PREFIX.csv\n\n"
+
+	"-h, --help\n"
+	"    print this help message\n\n"
+	);
+}
+
+// reproducible random numbers: std::mt19937_64's sequence is fixed
+// by the standard, but the library's distributions are not
+
+class Workload_RNG {
+  std::mt19937_64 g;
+public:
+  Workload_RNG(unsigned long long seed) : g(seed) {};
+
+  double uniform() {
+    return (g() >> 11) * (1.0 / 9007199254740992.0);
+  };
+
+  double uniform(double lo, double hi) {
+    return lo + (hi - lo) * uniform();
+  };
+
+  int integer(int lo, int hi) { // in [lo, hi]
+    return lo + (int) (uniform() * (hi - lo + 1));
+  };
+
+  double normal(double sd) {
+    double u = 1.0 - uniform();
+    return sd * sqrt(-2.0 * log(u)) * cos(2 * M_PI * uniform());
+  };
+
+  double exponential(double mean) {
+    return - mean * log(1.0 - uniform());
+  };
+};
+
+struct Workload_Params {
+  unsigned long long seed;
+  int freqs;
+  int lids;
+  int tags_per_lid;
+  double bi;
+  double bi_spread;
+  double detect_prob;
+  int wonkiness;
+  double noise_rate;
+  double duration;
+};
+
+struct Workload {
+  string tags_csv;   // as a TAGDB.CSV file
+  string hits_csv;   // as a TAGHITS.CSV file
+  size_t num_tags;
+  size_t num_hits;
+};
+
+static Workload
+generate(const Workload_Params & wp) {
+  static const double base_freqs[] = {166.38, 150.1, 151.5, 148.8};
+  static const Timestamp T0 = 1374672755.0;
+
+  Workload_RNG rng(wp.seed);
+  Workload w;
+  w.num_tags = 0;
+
+  struct Burst_Source {
+    Lotek_Tag_ID lid;
+    double freq;
+    double bi;
+  };
+  std::vector < Burst_Source > tags;
+  std::vector < double > freqs;
+
+  std::ostringstream tdb;
+  tdb << "\"proj\",\"id\",\"tagFreq\",\"bi\"\n";
+  for (int f = 0; f < wp.freqs; ++f) {
+    double freq = f < 4 ? base_freqs[f] : 152.0 + f;
+    freqs.push_back(freq);
+    for (int lid = 1; lid <= wp.lids; ++lid) {
+      std::vector < double > bis;
+      for (int k = 0; k < wp.tags_per_lid; ++k) {
+        // registered BIs are to 0.1 s, and distinct within a Lotek ID
+        double bi;
+        int tries = 0;
+        do {
+          bi = round(10 * std::max(1.0, rng.uniform(wp.bi - wp.bi_spread, wp.bi + wp.bi_spread))) / 10;
+        } while (std::find(bis.begin(), bis.end(), bi) != bis.end() && ++tries < 100);
+        bis.push_back(bi);
+        Burst_Source t = {(Lotek_Tag_ID) lid, freq, bi};
+        tags.push_back(t);
+        tdb << "\"proj" << (k + 1) << "\"," << lid << ',' << freq << ',' << bi << '\n';
+        ++w.num_tags;
+      }
+    }
+  }
+  w.tags_csv = tdb.str();
+
+  struct Gen_Hit {
+    Timestamp ts;
+    Lotek_Tag_ID lid;
+    double freq;
+    bool operator< (const Gen_Hit & h) const {return ts < h.ts;};
+  };
+  std::vector < Gen_Hit > hits;
+
+  // each tag is active for a random part of the stream
+
+  for (auto it = tags.begin(); it != tags.end(); ++it) {
+    double len = rng.uniform(0.1, 0.5) * wp.duration;
+    double start = rng.uniform(0, wp.duration - len);
+    for (double t = start + rng.uniform(0, it->bi); t < start + len; t += it->bi) {
+      if (rng.uniform() >= wp.detect_prob)
+        continue;
+      double ts = t + rng.normal(0.002);
+      if (wp.wonkiness > 0 && rng.uniform() < 0.05)
+        ts += rng.integer(- wp.wonkiness, wp.wonkiness);
+      Gen_Hit h = {T0 + ts, it->lid, it->freq};
+      hits.push_back(h);
+    }
+  }
+
+  // background noise, as a Poisson process
+
+  if (wp.noise_rate > 0) {
+    for (double t = rng.exponential(1 / wp.noise_rate); t < wp.duration; t += rng.exponential(1 / wp.noise_rate)) {
+      Gen_Hit h = {T0 + t, (Lotek_Tag_ID) rng.integer(1, wp.lids + 10), freqs[rng.integer(0, wp.freqs - 1)]};
+      hits.push_back(h);
+    }
+  }
+  std::stable_sort(hits.begin(), hits.end());
+
+  std::ostringstream hs;
+  char line[128];
+  for (size_t i = 0; i < hits.size(); ++i) {
+    snprintf(line, sizeof(line), "%.4f,%d,\"A%d\",%d,999,999,%lu,%.3f,%d,\"Lotek3\"\n",
+             hits[i].ts, (int) hits[i].lid, rng.integer(1, 4), rng.integer(30, 200),
+             (unsigned long) i + 1, hits[i].freq, rng.integer(20, 90));
+    hs << line;
+  }
+  w.hits_csv = hs.str();
+  w.num_hits = hits.size();
+  return w;
+};
+
+// sink counting hits, and discarding them
+
+class Null_Sink : public Output_Sink {
+public:
+  unsigned long long hits;
+
+  Null_Sink() : hits(0) {};
+
+  void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+    ++hits;
+  };
+};
+
+// hits from a vector, so that run finding can be timed without parsing
+
+class Vector_Hit_Source : public Hit_Source {
+  const std::vector < Hit > & hits;
+  size_t i;
+public:
+  Vector_Hit_Source(const std::vector < Hit > & hits) : hits(hits), i(0) {};
+
+  bool next(Hit &h) {
+    if (i == hits.size())
+      return false;
+    h = hits[i++];
+    return true;
+  };
+};
+
+// best wall-clock time of reps calls to f, in seconds
+
+template < typename F >
+static double
+best_time(int reps, F f) {
+  double best = 1e30;
+  for (int i = 0; i < reps; ++i) {
+    auto t0 = std::chrono::steady_clock::now();
+    f();
+    double secs = std::chrono::duration < double > (std::chrono::steady_clock::now() - t0).count();
+    best = std::min(best, secs);
+  }
+  return best;
+};
+
+static std::vector < Hit >
+parse_hits(const string & csv) {
+  std::istringstream in(csv);
+  std::unique_ptr < Line_Reader > lines(new Block_Line_Reader(& in));
+  CSV_Hit_Source src(lines.get());
+  Hit_Codes codes;
+  src.set_codes(& codes);
+  std::vector < Hit > hits;
+  Hit h;
+  while (src.next(h))
+    hits.push_back(h);
+  return hits;
+};
+
+int
+main (int argc, char **argv) {
+  enum {
+    OPT_BI_SPREAD    = 'B',
+    OPT_BI           = 'b',
+    OPT_CAND_HITS    = 'c',
+    OPT_DURATION     = 'd',
+    OPT_FREQS        = 'F',
+    COMMAND_HELP     = 'h',
+    OPT_TAGS_PER_LID = 'k',
+    OPT_LIDS         = 'l',
+    OPT_NOISE_RATE   = 'n',
+    OPT_OUTPUT       = 'o',
+    OPT_DETECT_PROB  = 'p',
+    OPT_REPS         = 'r',
+    OPT_SEED         = 's',
+    OPT_WONKINESS    = 't',
+  };
+
+  int option_index;
+  static const char short_options[] = "b:B:c:d:F:hk:l:n:o:p:r:s:t:";
+  static const struct option long_options[] = {
+    {"bi"              , 1, 0, OPT_BI},
+    {"bi-spread"       , 1, 0, OPT_BI_SPREAD},
+    {"cand-hits"       , 1, 0, OPT_CAND_HITS},
+    {"duration"        , 1, 0, OPT_DURATION},
+    {"freqs"           , 1, 0, OPT_FREQS},
+    {"help"            , 0, 0, COMMAND_HELP},
+    {"tags-per-lid"    , 1, 0, OPT_TAGS_PER_LID},
+    {"lids"            , 1, 0, OPT_LIDS},
+    {"noise-rate"      , 1, 0, OPT_NOISE_RATE},
+    {"output"          , 1, 0, OPT_OUTPUT},
+    {"detect-prob"     , 1, 0, OPT_DETECT_PROB},
+    {"reps"            , 1, 0, OPT_REPS},
+    {"seed"            , 1, 0, OPT_SEED},
+    {"wonkiness"       , 1, 0, OPT_WONKINESS},
+    {0, 0, 0, 0}
+  };
+
+  Workload_Params wp = {1, 2, 50, 2, 10, 5, 0.7, 0, 0.5, 86400};
+  int cand_hits = 3;
+  int reps = 3;
+  string output = "";
+
+  int c;
+  while ((c = getopt_long(argc, argv, short_options, long_options, &option_index)) != -1) {
+    switch (c) {
+    case OPT_BI:
+      wp.bi = atof(optarg);
+      break;
+    case OPT_BI_SPREAD:
+      wp.bi_spread = atof(optarg);
+      break;
+    case OPT_CAND_HITS:
+      cand_hits = atoi(optarg);
+      break;
+    case OPT_DURATION:
+      wp.duration = atof(optarg);
+      break;
+    case OPT_FREQS:
+      wp.freqs = atoi(optarg);
+      break;
+    case COMMAND_HELP:
+      usage();
+      exit(0);
+    case OPT_TAGS_PER_LID:
+      wp.tags_per_lid = atoi(optarg);
+      break;
+    case OPT_LIDS:
+      wp.lids = atoi(optarg);
+      break;
+    case OPT_NOISE_RATE:
+      wp.noise_rate = atof(optarg);
+      break;
+    case OPT_OUTPUT:
+      output = string(optarg);
+      break;
+    case OPT_DETECT_PROB:
+      wp.detect_prob = atof(optarg);
+      break;
+    case OPT_REPS:
+      reps = atoi(optarg);
+      break;
+    case OPT_SEED:
+      wp.seed = strtoull(optarg, 0, 10);
+      break;
+    case OPT_WONKINESS:
+      wp.wonkiness = atoi(optarg);
+      break;
+    default:
+      usage();
+      exit(1);
+    }
+  }
+  if (optind < argc || wp.freqs < 1 || wp.lids < 1 || wp.tags_per_lid < 1 || wp.duration <= 0
+      || wp.bi <= 0 || cand_hits < 1 || reps < 1) {
+    usage();
+    exit(1);
+  }
+
+  try {
+    Workload w = generate(wp);
+
+    if (output.length() > 0) {
+      std::ofstream t((output + ".tags").c_str()), h((output + ".csv").c_str());
+      t << w.tags_csv;
+      h << w.hits_csv;
+      if (! t.good() || ! h.good())
+        throw std::runtime_error(string("Couldn't write ") + output + ".tags and " + output + ".csv");
+      return 0;
+    }
+
+    // Tag_Database reads from a file
+
+    char tags_file[] = "/tmp/bench_filter_tags_XXXXXX";
+    int fd = mkstemp(tags_file);
+    if (fd < 0 || write(fd, w.tags_csv.data(), w.tags_csv.size()) != (ssize_t) w.tags_csv.size())
+      throw std::runtime_error("Couldn't write temporary tag database");
+    close(fd);
+    Tag_Database db(tags_file);
+    unlink(tags_file);
+    Freq_Setting::set_nominal_freqs(db.get_nominal_freqs());
+
+    Run_Params params;
+    params.timestamp_wonkiness = wp.wonkiness;
+
+    // line parser
+
+    std::vector < Hit > hits;
+    double parse_secs = best_time(reps, [&]() {hits = parse_hits(w.hits_csv);});
+
+    // Run_Foray end to end, from parsed hits
+
+    unsigned long long out_hits = 0;
+    size_t peak_cands = 0;
+    double foray_secs = best_time(reps, [&]() {
+        Vector_Hit_Source src(hits);
+        Null_Sink sink;
+        Run_Foray foray(& db, & src, & sink);
+        foray.set_params(params);
+        foray.start();
+        out_hits = sink.hits;
+        peak_cands = foray.peak_candidates();
+      });
+
+    // inner operations, on the graph for the first Lotek ID
+
+    Nominal_Frequency_kHz nf = * db.get_nominal_freqs().begin();
+    Null_Sink sink;
+    Vector_Hit_Source no_hits(hits);
+    Run_Foray owner(& db, & no_hits, & sink);
+    Run_Finder rf(& owner, params, nf);
+    rf.set_sink(& sink);
+    Tag_Set * ts = db.get_tags_at_freq(nf);
+    Known_Tag * tag = 0;
+    for (auto it = ts->begin(); it != ts->end(); ++it) {
+      if ((*it)->lid == 1) {
+        rf.add_tag(*it);
+        if (! tag || (*it)->bi < tag->bi)
+          tag = *it;
+      }
+    }
+    rf.init();
+    DFA_Graph * g = rf.get_graph(1);
+
+    // DFA_Graph::next(), on gaps which are multiples of the lid's
+    // burst intervals, with jitter, and occasionally off by a lot
+
+    Workload_RNG rng(wp.seed);
+    std::vector < Gap > gaps(1 << 16);
+    std::vector < Known_Tag * > lid_tags;
+    for (auto it = ts->begin(); it != ts->end(); ++it)
+      if ((*it)->lid == 1)
+        lid_tags.push_back(*it);
+    for (auto ig = gaps.begin(); ig != gaps.end(); ++ig) {
+      Known_Tag * t = lid_tags[rng.integer(0, lid_tags.size() - 1)];
+      *ig = rng.uniform() < 0.1 ? rng.uniform(0, 60) : t->bi * rng.integer(1, 3) + rng.normal(0.003);
+    }
+    const unsigned long long NEXT_OPS = 1 << 24;
+    unsigned long long accepted = 0;
+    double next_secs = best_time(reps, [&]() {
+        DFA_Node * n = g->get_root();
+        for (unsigned long long i = 0; i < NEXT_OPS; ++i) {
+          DFA_Node * m = g->next(n, gaps[i & (gaps.size() - 1)]);
+          if (m) {
+            n = m;
+            ++accepted;
+          } else {
+            n = g->get_root();
+          }
+        }
+      });
+
+    // candidates holding cand_hits hits of tag; those of b are later
+    // than, so disjoint from, those of a
+
+    auto make_candidate = [&](Timestamp t0) {
+      Hit h = Hit::make(owner.get_codes(), t0, 1, 0, 100, 999, 999, 0, nf / 1000.0, 50, 0);
+      Run_Candidate c(& rf, g, h);
+      for (int i = 1; i < cand_hits; ++i) {
+        h = Hit::make(owner.get_codes(), t0 + i * tag->bi, 1, 0, 100, 999, 999, 0, nf / 1000.0, 50, 0);
+        DFA_Node * s = c.advance_by_hit(h);
+        if (! s)
+          throw std::runtime_error("Internal error: benchmark candidate did not accept its hits");
+        c.add_hit(h, s);
+      }
+      return c;
+    };
+    Run_Candidate a = make_candidate(1374672755.0);
+    Run_Candidate b = make_candidate(1374672755.0 + 1000 * tag->bi);
+
+    // cloning, as Run_Finder does: a copy made in the slab
+
+    const unsigned long long CLONE_OPS = 1 << 20;
+    Cand_Slab slab;
+    double clone_secs = best_time(reps, [&]() {
+        for (unsigned long long i = 0; i < CLONE_OPS; ++i)
+          slab.release(slab.make(a));
+      });
+
+    const unsigned long long SHARES_OPS = 1 << 22;
+    unsigned long long shared = 0;
+    double shares_secs = best_time(reps, [&]() {
+        for (unsigned long long i = 0; i < SHARES_OPS; ++i)
+          shared += a.shares_any_hits(i & 1 ? a : b);
+      });
+
+    printf("{\n");
+    printf("  \"workload\": {\"seed\": %llu, \"freqs\": %d, \"lids\": %d, \"tags_per_lid\": %d, \"bi\": %g, \"bi_spread\": %g, "
+           "\"detect_prob\": %g, \"wonkiness\": %d, \"noise_rate\": %g, \"duration\": %g, \"tags\": %lu, \"hits\": %lu},\n",
+           wp.seed, wp.freqs, wp.lids, wp.tags_per_lid, wp.bi, wp.bi_spread, wp.detect_prob, wp.wonkiness,
+           wp.noise_rate, wp.duration, (unsigned long) w.num_tags, (unsigned long) w.num_hits);
+    printf("  \"reps\": %d,\n", reps);
+    printf("  \"results\": [\n");
+    printf("    {\"name\": \"parse\", \"seconds\": %.6f, \"hits_per_sec\": %.0f},\n",
+           parse_secs, hits.size() / parse_secs);
+    printf("    {\"name\": \"run_foray\", \"seconds\": %.6f, \"hits_per_sec\": %.0f, \"output_hits\": %llu, \"peak_candidates\": %lu},\n",
+           foray_secs, hits.size() / foray_secs, out_hits, (unsigned long) peak_cands);
+    printf("    {\"name\": \"dfa_next\", \"ops\": %llu, \"ns_per_op\": %.3f, \"accepted\": %llu},\n",
+           NEXT_OPS, next_secs * 1e9 / NEXT_OPS, accepted / reps);
+    printf("    {\"name\": \"candidate_clone\", \"ops\": %llu, \"ns_per_op\": %.3f, \"hits_per_candidate\": %d},\n",
+           CLONE_OPS, clone_secs * 1e9 / CLONE_OPS, cand_hits);
+    printf("    {\"name\": \"shares_any_hits\", \"ops\": %llu, \"ns_per_op\": %.3f, \"hits_per_candidate\": %d, \"shared\": %llu}\n",
+           SHARES_OPS, shares_secs * 1e9 / SHARES_OPS, cand_hits, shared / reps);
+    printf("  ]\n");
+    printf("}\n");
+  } catch (std::runtime_error& e) {
+    std::cerr << e.what();
+    exit(1);
+  }
+}
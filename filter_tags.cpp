@@ -42,6 +42,21 @@
 #include "Hit.hpp"
 #include "Run_Candidate.hpp"
 #include "Run_Foray.hpp"
+#include "CSV_Hit_Source.hpp"
+#include "Column_Hit_Source.hpp"
+#include "SQLite_Hit_Source.hpp"
+#include "Binary_Sink.hpp"
+#include "SQLite_Sink.hpp"
+#include "Param_Sweep.hpp"
+#include "Receiver_Batch.hpp"
+
+#include <memory>
+#include <thread>
+#include <signal.h>
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 //#define FILTER_TAGS_DEBUG
 
@@ -50,6 +65,10 @@ usage() {
   puts (
 	"Usage:\n"
 	"    filter_tags [OPTIONS] TAGDB.CSV [TAGHITS.CSV]\n"
+	"or:\n"
+	"    filter_tags [OPTIONS] --tag-db=DBFILE [TAGHITS.CSV]\n"
+	"or:\n"
+	"    filter_tags [OPTIONS] --batch=OUTDIR TAGDB.CSV TAGHITS.CSV...\n"
 	"where:\n\n"
 
 	"TAGDB.CSV is a file holding a table of registered tags\n"
@@ -81,10 +100,25 @@ usage() {
         "     antfreq - antenna listening frequency, in MHz\n"
         "     codeset - factor - Lotek codset name - this field is treated as a string\n\n"
 
-	"    If unspecified, tag hits are read from stdin\n\n"
+	"    If unspecified, tag hits are read from stdin, unless --input-db is given\n\n"
+
+	"    With --input-format=columns, TAGHITS.CSV is instead a file of binary columns\n"
+	"    holding the same fields, as described in Column_Hit_Source.hpp, which R's\n"
+	"    writeBin() can write directly from numeric vectors.\n\n"
 
 	"and OPTIONS can be any of:\n\n"
 
+	"-a, --batch=OUTDIR\n"
+	"    filter each of several TAGHITS.CSV files, from different receivers,\n"
+	"    against the same tags.  The DFA graphs are built (or read with\n"
+	"    --graph-cache) only once, and shared by all files, which are filtered\n"
+	"    at the same time on --jobs threads.  Hits from each file are written\n"
+	"    to OUTDIR/NAME.csv (or OUTDIR/NAME.ftb, with --output-format=binary),\n"
+	"    where NAME is the file's name without its directory or extension,\n"
+	"    exactly as a separate run on that file would write them.  Not valid\n"
+	"    with --output-format=sqlite, --input-db, --stream, --checkpoint,\n"
+	"    --resume, --sweep, --stats-file, --freq-threads or --workers.\n\n"
+
 	"-b, --burst-slop=BSLOP\n"
 	"    how much to allow time between consecutive bursts\n"
 	"    to differ from measured tag values, in millseconds.\n"
@@ -99,16 +133,154 @@ usage() {
 	"    how many hits must be detected before a run is confirmed.\n"
 	"    default: 2\n\n"
 
-        "-h  --help\n"
-        "    print this help message\n\n"
+	"-C, --checkpoint=FILE\n"
+	"    at the end of input, save the state of run finding (runs in progress,\n"
+	"    and counters for run IDs) to FILE, so that a later invocation given\n"
+	"    --resume=FILE can continue with the next part of the input.  Output\n"
+	"    from the two parts is then the same as if they had been processed\n"
+	"    together.\n\n"
+
+	"-d, --input-db=DBFILE\n"
+	"    read tag hits from the SQLite database DBFILE instead of from TAGHITS.CSV,\n"
+	"    as the rows returned by the query given by --input-query.\n\n"
+
+	"-e, --expiry-lag=SECS\n"
+	"    end run candidates for every Lotek ID once the latest timestamp read is\n"
+	"    SECS past the last time they could take a hit, rather than only when a\n"
+	"    later hit of their own ID finds them too old.  This bounds memory when\n"
+	"    IDs stop getting hits, but output can change if hits are out of order\n"
+	"    by more than SECS seconds.  --stream always does this, with --lateness\n"
+	"    as the lag.  default: off\n\n"
+
+	"-f, --freq-threads\n"
+	"    run the filter for each nominal frequency on its own worker thread.\n"
+	"    Output is identical to that from the default single-threaded mode,\n"
+	"    with or without --expiry-lag.\n\n"
+
+	"-g, --graph-cache=DIR\n"
+	"    keep the DFA graphs built from the tag database in directory DIR, and\n"
+	"    use those saved by an earlier run with the same tags and values of\n"
+	"    -b, -B, -c, -S and -t instead of building them again.  This makes\n"
+	"    startup faster for large tag databases.  Ignored with --icl-edges.\n\n"
+
+	"-G, --lazy-graphs\n"
+	"    build the DFA graph for each Lotek ID only when the first hit with that\n"
+	"    ID is read, instead of for every tag in the database at startup.  This\n"
+	"    saves time and memory when the input holds only a few of the database's\n"
+	"    tags; output is identical.  Warnings about tags which can't be told\n"
+	"    apart are only given for IDs in the input.\n\n"
+
+	"-h, --help\n"
+	"    print this help message\n\n"
 
 	"-H, --header-only\n"
 	"    output the header ONLY; does no processing.\n\n"
 
+	"-i, --icl-edges\n"
+	"    walk DFA graphs using their interval_maps directly, rather than\n"
+	"    the flat arrays they are compiled to once built.  Output is identical;\n"
+	"    this is only useful for comparing speed.\n\n"
+
+	"-I, --input-format=FORMAT\n"
+	"    read TAGHITS.CSV as FORMAT, which is one of:\n"
+	"       csv: comma-separated text (the default)\n"
+	"       columns: fixed-width binary columns, mapped into memory, so that\n"
+	"          no text is parsed; the file must be named, and is not valid with\n"
+	"          --stream or --input-db.  With --batch, every input is in this format.\n\n"
+
+	"-j, --jobs=N\n"
+	"    with --batch, filter at most N files at once.\n"
+	"    default: the number of processors\n\n"
+
+	"-l, --lateness=SECS\n"
+	"    with --stream, how many seconds a hit's timestamp may be behind the\n"
+	"    watermark (see --watermark) and still be filtered exactly as it would\n"
+	"    be without --stream; hits later than that can be filtered differently,\n"
+	"    as candidates they could have joined may already have been ended.\n"
+	"    default: 10\n\n"
+
+	"-L, --max-latency=SECS\n"
+	"    with --stream, write output, and end runs which have missed too many\n"
+	"    bursts, at least every SECS seconds.  default: 1\n\n"
+
+	"-m, --max-candidates=N\n"
+	"    keep at most N run candidates for each Lotek ID on each nominal\n"
+	"    frequency; when there would be more, the unconfirmed candidates with\n"
+	"    the fewest hits, and of those the oldest, are dropped.  This bounds the\n"
+	"    time taken per hit when interference floods an ID with hits, at the\n"
+	"    risk of missing runs.  The number dropped is reported on stderr.\n"
+	"    default: 0, meaning no limit\n\n"
+
+	"-M, --max-total-candidates=N\n"
+	"    as for --max-candidates, but for all Lotek IDs on a nominal frequency\n"
+	"    together.  Candidates are only dropped for the ID of the hit which took\n"
+	"    the total over N.  Not valid with --workers.  default: 0, meaning no\n"
+	"    limit\n\n"
+
 	"-n, --no-header\n"
 	"    don't output the column names header; useful when output\n"
 	"    is to be appended to an existing .CSV file.\n\n"
 
+	"-o, --output-format=FORMAT\n"
+	"    write hits from confirmed runs as FORMAT, which is one of:\n"
+	"       csv: comma-separated text (the default)\n"
+	"       binary: little-endian column blocks with tables of antenna codes\n"
+	"          and tag IDs, which can be loaded in one read without text\n"
+	"          parsing; read_ftb converts it to .CSV.  There is no header.\n"
+	"       sqlite: rows of table 'hits', with the same columns as the .CSV,\n"
+	"          in the database given by --output-db, after a column runSet\n"
+	"          which numbers the invocations writing to it (see --output-db)\n\n"
+
+	"-O, --output-db=DBFILE\n"
+	"    SQLite database to write to with --output-format=sqlite; it is created\n"
+	"    if it doesn't exist, and hits are appended to any already there.\n"
+	"    Run IDs restart with each invocation, so each one's hits (and runs,\n"
+	"    with --run-summary) get a new runSet, one more than the largest in\n"
+	"    the database; with --resume, they keep the latest runSet, as run IDs\n"
+	"    carry on from the checkpoint.  A run is identified by (runSet, runID).\n\n"
+
+	"-P, --sweep=FILE\n"
+	"    filter the input with each of several sets of parameters at once, each\n"
+	"    on its own thread, reading the input only once.  Each line of FILE is:\n"
+	"        NAME,BSLOP,BSLOPEXP,CONFIRM,SKIPS,WONK\n"
+	"    giving values for -b, -B, -c, -S and -t; an empty field takes the value\n"
+	"    given on the command line, or the default.  Blank lines and lines\n"
+	"    beginning with '#' are ignored.  Hits for each set are written to file\n"
+	"    NAME.csv (or NAME.ftb, with --output-format=binary), exactly as a\n"
+	"    separate run with those parameters would write them, and a table\n"
+	"    giving the number of runs and hits for each set is written to stdout.\n"
+	"    Not valid with --output-format=sqlite, --stream, --checkpoint or --resume.\n\n"
+
+	"-q, --input-query=SQL\n"
+	"    with --input-db, the query giving tag hits, whose columns must be, in order,\n"
+	"    ts, id, ant, sig, lat, lon, dtaline, antfreq, gain, and optionally codeset,\n"
+	"    as in TAGHITS.CSV.  Rows must be in the order they are to be processed.\n"
+	"    default: SELECT ts, id, ant, sig, lat, lon, dtaline, antfreq, gain, codeset FROM hits\n\n"
+
+	"-Q, --tag-query=SQL\n"
+	"    with --tag-db, the query giving registered tags, whose columns must be,\n"
+	"    in order, proj, id, tagFreq, bi, as in TAGDB.CSV.\n"
+	"    default: SELECT proj, id, tagFreq, bi FROM tags\n\n"
+
+	"-r, --run-summary\n"
+	"    with --output-format=sqlite, also maintain table 'runs', with one row\n"
+	"    per run giving its runSet, runID, id, tsBegin, tsEnd, and len (number\n"
+	"    of hits).\n\n"
+
+	"-R, --resume=FILE\n"
+	"    before reading input, restore the state saved by --checkpoint=FILE.\n"
+	"    The tag database and the options -b, -B, -c, -S and -t must be the same\n"
+	"    as when it was saved.  FILE may also be given to --checkpoint.\n\n"
+
+	"-s, --stream\n"
+	"    run indefinitely on a never-ending stream of hits, as from a live\n"
+	"    receiver: TAGHITS.CSV is followed as it grows, and a pipe is read until\n"
+	"    it is closed.  Processing stops cleanly on SIGINT, SIGTERM or SIGHUP,\n"
+	"    after which state is saved if --checkpoint was given.  Memory use stays\n"
+	"    bounded, as runs are ended by the watermark rather than only by later\n"
+	"    hits of the same tag.  Hits are filtered by a single thread, so\n"
+	"    --freq-threads and --workers are ignored.  Not valid with --input-db.\n\n"
+
 	"-S, --max-skipped-bursts=SKIPS\n"
 	"    maximum number of consecutive bursts that can be missing (skipped)\n"
 	"    without terminating a run.  When using the pulses_to_confirm criterion\n"
@@ -128,33 +300,134 @@ usage() {
         "    a sequence of observed BIs like (BI - 1, BI - 1, BI - 1, ...) which is clearly\n"
         "    from another tag\n\n"
 
+	"-T, --tag-db=DBFILE\n"
+	"    read registered tags from the SQLite database DBFILE instead of from\n"
+	"    TAGDB.CSV, as the rows returned by the query given by --tag-query.  If\n"
+	"    hits are read with --input-db, only tags on the nominal frequencies\n"
+	"    those hits are on are loaded.\n\n"
+
+	"-w, --workers=N\n"
+	"    filter each (nominal frequency, Lotek ID) pair separately, using a pool\n"
+	"    of N worker threads.  Takes precedence over --freq-threads.  Output is\n"
+	"    identical to that from the default single-threaded mode, with or\n"
+	"    without --expiry-lag.\n\n"
+
+	"-W, --watermark=SOURCE\n"
+	"    with --stream, the time up to which input is assumed to be complete,\n"
+	"    less the --lateness, is taken from SOURCE, which is one of:\n"
+	"       input: the latest timestamp among hits read so far (the default)\n"
+	"       clock: the current time; use this when the receiver's clock is\n"
+	"          correct, so that runs can end while no hits arrive at all\n\n"
+
+	"-x, --stats-file=FILE\n"
+	"    write run-finding statistics to FILE rather than to stderr.  Statistics\n"
+	"    are only kept by a build with -DFILTER_TAGS_STATS (see the Makefile);\n"
+	"    this option is an error otherwise.\n\n"
+
 	);
 }
 
+// when streaming, stop cleanly on the usual signals.  Handlers are
+// installed without SA_RESTART, so that a signal interrupts a wait
+// for input.
+
+static void
+on_stop_signal(int sig) {
+  Run_Foray::request_stop();
+}
+
+static void
+catch_stop_signals() {
+#ifndef _WIN32
+  struct sigaction sa;
+  memset(& sa, 0, sizeof(sa));
+  sa.sa_handler = on_stop_signal;
+  sigemptyset(& sa.sa_mask);
+  sigaction(SIGINT, & sa, 0);
+  sigaction(SIGTERM, & sa, 0);
+  sigaction(SIGHUP, & sa, 0);
+#else
+  signal(SIGINT, on_stop_signal);
+  signal(SIGTERM, on_stop_signal);
+#endif
+}
+
 int
 main (int argc, char **argv) {
       enum {
+	OPT_BATCH                = 'a',
 	OPT_BURST_SLOP	         = 'b',
 	OPT_BURST_SLOP_EXPANSION = 'B',
 	OPT_HITS_TO_CONFIRM      = 'c',
+	OPT_CHECKPOINT           = 'C',
+	OPT_INPUT_DB             = 'd',
+	OPT_EXPIRY_LAG           = 'e',
+	OPT_FREQ_THREADS         = 'f',
+	OPT_GRAPH_CACHE          = 'g',
+	OPT_LAZY_GRAPHS          = 'G',
         COMMAND_HELP	         = 'h',
 	OPT_HEADER_ONLY	         = 'H',
+	OPT_ICL_EDGES            = 'i',
+	OPT_INPUT_FORMAT         = 'I',
+	OPT_JOBS                 = 'j',
+	OPT_LATENESS             = 'l',
+	OPT_MAX_LATENCY          = 'L',
+	OPT_MAX_CANDS            = 'm',
+	OPT_MAX_TOTAL_CANDS      = 'M',
 	OPT_NO_HEADER	         = 'n',
+	OPT_OUTPUT_FORMAT        = 'o',
+	OPT_OUTPUT_DB            = 'O',
+	OPT_SWEEP                = 'P',
+	OPT_INPUT_QUERY          = 'q',
+	OPT_TAG_QUERY            = 'Q',
+	OPT_RUN_SUMMARY          = 'r',
+	OPT_RESUME               = 'R',
+	OPT_STREAM               = 's',
 	OPT_MAX_SKIPPED_BURSTS   = 'S',
         OPT_TIMESTAMP_WONKINESS  = 't',
+	OPT_TAG_DB               = 'T',
+	OPT_WORKERS              = 'w',
+	OPT_WATERMARK            = 'W',
+	OPT_STATS_FILE           = 'x',
     };
 
     int option_index;
-    static const char short_options[] = "b:B:c:hHnS:t:";
+    static const char short_options[] = "a:b:B:c:C:d:e:fg:GhHiI:j:l:L:m:M:no:O:P:q:Q:rR:sS:t:T:w:W:x:";
     static const struct option long_options[] = {
+	{"batch"		   , 1, 0, OPT_BATCH},
         {"burst-slop"		   , 1, 0, OPT_BURST_SLOP},
         {"burst-slop-expansion"    , 1, 0, OPT_BURST_SLOP_EXPANSION},
 	{"hits-to-confirm"	   , 1, 0, OPT_HITS_TO_CONFIRM},
+	{"checkpoint"		   , 1, 0, OPT_CHECKPOINT},
+	{"input-db"		   , 1, 0, OPT_INPUT_DB},
+	{"expiry-lag"		   , 1, 0, OPT_EXPIRY_LAG},
+	{"freq-threads"		   , 0, 0, OPT_FREQ_THREADS},
+	{"graph-cache"		   , 1, 0, OPT_GRAPH_CACHE},
+	{"lazy-graphs"		   , 0, 0, OPT_LAZY_GRAPHS},
         {"help"			   , 0, 0, COMMAND_HELP},
 	{"header-only"		   , 0, 0, OPT_HEADER_ONLY},
+	{"icl-edges"		   , 0, 0, OPT_ICL_EDGES},
+	{"input-format"		   , 1, 0, OPT_INPUT_FORMAT},
+	{"jobs"			   , 1, 0, OPT_JOBS},
+	{"lateness"		   , 1, 0, OPT_LATENESS},
+	{"max-latency"		   , 1, 0, OPT_MAX_LATENCY},
+	{"max-candidates"	   , 1, 0, OPT_MAX_CANDS},
+	{"max-total-candidates"	   , 1, 0, OPT_MAX_TOTAL_CANDS},
 	{"no-header"		   , 0, 0, OPT_NO_HEADER},
+	{"output-format"	   , 1, 0, OPT_OUTPUT_FORMAT},
+	{"output-db"		   , 1, 0, OPT_OUTPUT_DB},
+	{"sweep"		   , 1, 0, OPT_SWEEP},
+	{"input-query"		   , 1, 0, OPT_INPUT_QUERY},
+	{"tag-query"		   , 1, 0, OPT_TAG_QUERY},
+	{"run-summary"		   , 0, 0, OPT_RUN_SUMMARY},
+	{"resume"		   , 1, 0, OPT_RESUME},
+	{"stream"		   , 0, 0, OPT_STREAM},
 	{"max-skipped-bursts"      , 1, 0, OPT_MAX_SKIPPED_BURSTS},
         {"timestamp-wonkiness"     , 1, 0, OPT_TIMESTAMP_WONKINESS},
+	{"tag-db"		   , 1, 0, OPT_TAG_DB},
+	{"workers"		   , 1, 0, OPT_WORKERS},
+	{"watermark"		   , 1, 0, OPT_WATERMARK},
+	{"stats-file"		   , 1, 0, OPT_STATS_FILE},
         {0, 0, 0, 0}
     };
 
@@ -162,20 +435,61 @@ main (int argc, char **argv) {
 
     string tagdb_filename;
     string hits_filename = "";
+    string input_db = "";
+    string input_query = SQLite_Hit_Source::DEFAULT_QUERY;
+    string tag_db_filename = "";
+    string tag_query = Tag_Database::DEFAULT_QUERY;
 
     bool header_desired = true;
-    unsigned int timestamp_wonkiness = 0;
+    string output_format = "csv";
+    string input_format = "csv";
+    string output_db = "";
+    bool run_summary = false;
+    string checkpoint_file = "";
+    string resume_file = "";
+    string graph_cache_dir = "";
+    string sweep_file = "";
+    string batch_dir = "";
+    unsigned int num_jobs = std::thread::hardware_concurrency();
+    string stats_file = "";
+    bool lazy_graphs = false;
+    bool stream = false;
+    bool clock_watermark = false;
+    double lateness = 10;
+    double max_latency = 1;
+    bool freq_threads = false;
+    unsigned int num_workers = 0;
+    int timestamp_wonkiness = 0;
+    Run_Params params;
 
     while ((c = getopt_long(argc, argv, short_options, long_options, &option_index)) != -1) {
         switch (c) {
+	case OPT_BATCH:
+	  batch_dir = string(optarg);
+	  break;
         case OPT_BURST_SLOP:
-	  Run_Finder::set_default_burst_slop_ms(atof(optarg));
+	  params.set_burst_slop_ms(atof(optarg));
 	  break;
         case OPT_BURST_SLOP_EXPANSION:
-	  Run_Finder::set_default_burst_slop_expansion_ms(atof(optarg));
+	  params.set_burst_slop_expansion_ms(atof(optarg));
 	  break;
 	case OPT_HITS_TO_CONFIRM:
-	  Run_Candidate::set_hits_to_confirm_id(atoi(optarg));
+	  params.hits_to_confirm_id = atoi(optarg);
+	  break;
+	case OPT_CHECKPOINT:
+	  checkpoint_file = string(optarg);
+	  break;
+	case OPT_INPUT_DB:
+	  input_db = string(optarg);
+	  break;
+	case OPT_FREQ_THREADS:
+	  freq_threads = true;
+	  break;
+	case OPT_GRAPH_CACHE:
+	  graph_cache_dir = string(optarg);
+	  break;
+	case OPT_LAZY_GRAPHS:
+	  lazy_graphs = true;
 	  break;
         case COMMAND_HELP:
             usage();
@@ -183,18 +497,99 @@ main (int argc, char **argv) {
 	case OPT_HEADER_ONLY:
 	  Run_Candidate::output_header(&std::cout);
 	  exit(0);
+	case OPT_ICL_EDGES:
+	  DFA_Node::use_flat_edges = false;
+	  break;
+	case OPT_INPUT_FORMAT:
+	  input_format = string(optarg);
+	  if (input_format != "csv" && input_format != "columns") {
+	    usage();
+	    exit(1);
+	  }
+	  break;
+	case OPT_JOBS:
+	  num_jobs = atoi(optarg);
+	  break;
+	case OPT_EXPIRY_LAG:
+	  params.expiry_lag = atof(optarg);
+	  if (params.expiry_lag < 0) {
+	    usage();
+	    exit(1);
+	  }
+	  break;
+	case OPT_LATENESS:
+	  lateness = atof(optarg);
+	  break;
+	case OPT_MAX_LATENCY:
+	  max_latency = atof(optarg);
+	  break;
 	case OPT_NO_HEADER:
 	  header_desired = false;
 	  break;
+	case OPT_OUTPUT_FORMAT:
+	  output_format = string(optarg);
+	  if (output_format != "csv" && output_format != "binary" && output_format != "sqlite") {
+	    usage();
+	    exit(1);
+	  }
+	  break;
+	case OPT_OUTPUT_DB:
+	  output_db = string(optarg);
+	  break;
+	case OPT_SWEEP:
+	  sweep_file = string(optarg);
+	  break;
+	case OPT_INPUT_QUERY:
+	  input_query = string(optarg);
+	  break;
+	case OPT_RUN_SUMMARY:
+	  run_summary = true;
+	  break;
+	case OPT_RESUME:
+	  resume_file = string(optarg);
+	  break;
+	case OPT_STREAM:
+	  stream = true;
+	  break;
 	case OPT_MAX_SKIPPED_BURSTS:
-	  Run_Finder::set_default_max_skipped_bursts(atoi(optarg));
+	  params.max_skipped_bursts = atoi(optarg);
 	  break;
 	case OPT_TIMESTAMP_WONKINESS:
           timestamp_wonkiness = atoi(optarg);
           if (timestamp_wonkiness < 0)
             throw std::runtime_error("timestamp_wonkiness (-t) must be non-negative");
-          Run_Finder::set_timestamp_wonkiness(timestamp_wonkiness);
+          params.timestamp_wonkiness = timestamp_wonkiness;
           break;
+	case OPT_TAG_DB:
+	  tag_db_filename = string(optarg);
+	  break;
+	case OPT_TAG_QUERY:
+	  tag_query = string(optarg);
+	  break;
+	case OPT_WORKERS:
+	  num_workers = atoi(optarg);
+	  break;
+	case OPT_WATERMARK:
+	  if (string(optarg) == "clock") {
+	    clock_watermark = true;
+	  } else if (string(optarg) != "input") {
+	    usage();
+	    exit(1);
+	  }
+	  break;
+	case OPT_MAX_CANDS:
+	  params.max_cands_per_id = atoi(optarg);
+	  break;
+	case OPT_MAX_TOTAL_CANDS:
+	  params.max_cands_total = atoi(optarg);
+	  break;
+	case OPT_STATS_FILE:
+#ifndef FILTER_TAGS_STATS
+	  std::cerr << "--stats-file needs a build with -DFILTER_TAGS_STATS\n";
+	  exit(1);
+#endif
+	  stats_file = string(optarg);
+	  break;
         default:
             usage();
             exit(1);
@@ -202,40 +597,163 @@ main (int argc, char **argv) {
     }
 
 
-    if (optind == argc) {
+    if ((optind == argc && tag_db_filename.length() == 0) || (output_format == "sqlite") != (output_db.length() > 0)
+        || (stream && input_db.length() > 0) || max_latency <= 0
+        || (num_workers > 0 && params.max_cands_total > 0)
+        || (input_format == "columns" && (stream || input_db.length() > 0))
+        || (sweep_file.length() > 0 && (output_format == "sqlite" || stream || checkpoint_file.length() > 0 || resume_file.length() > 0))
+        || (batch_dir.length() > 0 && (output_format == "sqlite" || input_db.length() > 0 || stream || checkpoint_file.length() > 0
+                                       || resume_file.length() > 0 || sweep_file.length() > 0 || stats_file.length() > 0
+                                       || freq_threads || num_workers > 0))) {
       usage();
       exit(1);
     }
 
-    tagdb_filename = string(argv[optind++]);
+    // with --tag-db, there is no TAGDB.CSV argument
+
+    if (tag_db_filename.length() == 0)
+      tagdb_filename = string(argv[optind++]);
+
+    // in a batch, every remaining argument is an input file
+
+    std::vector < string > batch_files;
+    if (batch_dir.length() > 0) {
+      if (optind == argc) {
+        usage();
+        exit(1);
+      }
+      batch_files.assign(argv + optind, argv + argc);
+      optind = argc;
+    }
     if (optind < argc) {
+      if (input_db.length() > 0) {
+        usage();
+        exit(1);
+      }
       hits_filename = string(argv[optind++]);
     }
+    if (input_format == "columns" && batch_dir.length() == 0 && hits_filename.length() == 0) {
+      usage();
+      exit(1);
+    }
 
     try {
       // set options and parameters
 
-      Tag_Database tag_db(tagdb_filename);
-
-      // Freq_Setting needs to know the set of nominal frequencies
-      Freq_Setting::set_nominal_freqs(tag_db.get_nominal_freqs());
+      // open the input; a named file is mapped into memory where possible.
+      // In a batch, each receiver opens its own.
+
+      std::unique_ptr < Hit_Source > hits;
+      SQLite_Hit_Source * db_hits = 0;
+      if (input_db.length() > 0) {
+        hits.reset(db_hits = new SQLite_Hit_Source(input_db, input_query));
+      } else if (input_format == "columns") {
+        if (batch_dir.length() == 0)
+          hits.reset(new Column_Hit_Source(hits_filename));
+      } else if (batch_dir.length() == 0) {
+        Line_Reader * lines;
+        if (stream) {
+          // wake up at least every max_latency seconds, even if no hits arrive
+          if (hits_filename.length() > 0)
+            lines = Follow_Line_Reader::open(hits_filename, max_latency);
+          else
+            lines = new Follow_Line_Reader(0, max_latency);
+        } else if (hits_filename.length() > 0) {
+          lines = Line_Reader::open(hits_filename);
+        } else {
+          lines = new Block_Line_Reader(& std::cin);
+        }
+        hits.reset(new CSV_Hit_Source(lines));
+      }
 
-      // open the input stream
+      // when both tags and hits come from databases, only tags on
+      // frequencies some hit is on are loaded
 
-      std::istream * hits;
-      if (hits_filename.length() > 0) {
-        hits = new ifstream(hits_filename.c_str());
+      std::unique_ptr < Tag_Database > tag_db;
+      if (tag_db_filename.length() > 0) {
+        std::vector < Frequency_MHz > hit_freqs;
+        if (db_hits)
+          hit_freqs = db_hits->get_ant_freqs();
+        tag_db.reset(new Tag_Database(tag_db_filename, tag_query, db_hits ? & hit_freqs : 0));
       } else {
-        hits = & std::cin;
+        tag_db.reset(new Tag_Database(tagdb_filename));
+      }
+
+      // Freq_Setting needs to know the set of nominal frequencies
+      Freq_Setting::set_nominal_freqs(tag_db->get_nominal_freqs());
+
+      // in a batch, each receiver has its own output file
+
+      if (batch_dir.length() > 0) {
+        Receiver_Batch batch(tag_db.get(), params);
+        for (auto ib = batch_files.begin(); ib != batch_files.end(); ++ib)
+          batch.add_receiver(*ib);
+        batch.set_input_columns(input_format == "columns");
+        batch.set_output(batch_dir, output_format == "binary", header_desired);
+        batch.set_graph_cache_dir(graph_cache_dir);
+        batch.set_num_threads(num_jobs);
+        batch.start();
+        return 0;
       }
 
-      if (hits->fail())
-        throw std::runtime_error(string("Couldn't open input file ") + hits_filename);
+      // in a sweep, each set of parameters has its own output file
+
+      if (sweep_file.length() > 0) {
+        std::vector < Param_Sweep::Config > configs = Param_Sweep::read_configs(sweep_file, params);
+        std::vector < std::unique_ptr < std::ofstream > > files;
+        std::vector < std::unique_ptr < Output_Sink > > sinks;
+        Param_Sweep sweep(tag_db.get(), hits.get());
+        for (auto ic = configs.begin(); ic != configs.end(); ++ic) {
+          bool binary = output_format == "binary";
+          string filename = ic->name + (binary ? ".ftb" : ".csv");
+          std::ofstream * f = new std::ofstream(filename.c_str(), binary ? std::ios::out | std::ios::binary : std::ios::out);
+          files.push_back(std::unique_ptr < std::ofstream > (f));
+          if (! f->good())
+            throw std::runtime_error(string("Couldn't open output file ") + filename);
+          if (binary) {
+            sinks.push_back(std::unique_ptr < Output_Sink > (new Binary_Sink(f)));
+          } else {
+            if (header_desired)
+              Run_Candidate::output_header(f);
+            sinks.push_back(std::unique_ptr < Output_Sink > (new Buffered_CSV_Sink(f)));
+          }
+          sweep.add_config(*ic, sinks.back().get());
+        }
+        sweep.set_graph_cache_dir(graph_cache_dir);
+        sweep.set_lazy_graphs(lazy_graphs);
+        sweep.start(& std::cout);
+        return 0;
+      }
 
-      if (header_desired)
-        Run_Candidate::output_header(&std::cout);
+      // the .CSV header is only written for .CSV output
 
-      Run_Foray foray(& tag_db, hits, & std::cout);
+      std::unique_ptr < Output_Sink > sink;
+      if (output_format == "binary") {
+#ifdef _WIN32
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        sink.reset(new Binary_Sink(& std::cout));
+      } else if (output_format == "sqlite") {
+        sink.reset(new SQLite_Sink(output_db, run_summary, resume_file.length() > 0));
+      } else {
+        if (header_desired)
+          Run_Candidate::output_header(&std::cout);
+        sink.reset(new Buffered_CSV_Sink(& std::cout));
+      }
+
+      Run_Foray foray(tag_db.get(), hits.get(), sink.get());
+      foray.set_params(params);
+      foray.set_freq_threads(freq_threads);
+      foray.set_num_workers(num_workers);
+      foray.set_resume_file(resume_file);
+      foray.set_checkpoint_file(checkpoint_file);
+      foray.set_graph_cache_dir(graph_cache_dir);
+      foray.set_lazy_graphs(lazy_graphs);
+      foray.set_stats_file(stats_file);
+      if (stream) {
+        foray.set_streaming(clock_watermark, lateness, max_latency);
+        catch_stop_signals();
+      }
 
       foray.start();
     } catch (std::runtime_error& e) {
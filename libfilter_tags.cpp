@@ -0,0 +1,199 @@
+// libfilter_tags.cpp - the C interface declared in libfilter_tags.h
+
+#include "libfilter_tags.h"
+
+#include "filter_tags_common.hpp"
+#include "Tag_Database.hpp"
+#include "Run_Foray.hpp"
+#include "Output_Sink.hpp"
+
+#include <deque>
+#include <memory>
+#include <new>
+
+namespace {
+
+  // hand hits from confirmed runs to the engine's callback, or queue them
+
+  class Callback_Sink : public Output_Sink {
+  public:
+    Tag_Database * tags;
+    ft_callback cb;
+    void * user;
+    std::deque < ft_run_hit > queue;
+
+    Callback_Sink() : tags(0), cb(0), user(0), queue() {};
+
+    void put(const string &prefix, const Hit &h, Known_Tag *tag, unsigned long long run_id, unsigned int pos_in_run, double burst_slop) {
+      ft_run_hit r;
+      r.hit = h.seq_no - 1;
+      r.ts = h.ts;
+      r.ant = h.ant_code;
+      r.tag = tags->index_of(tag);
+      r.tag_id = tag->fullID.c_str();
+      r.run_id = run_id;
+      r.pos_in_run = pos_in_run;
+      r.burst_slop = burst_slop;
+      if (cb)
+        cb(user, & r);
+      else
+        queue.push_back(r);
+    };
+  };
+};
+
+struct ft_engine {
+  Run_Params params;
+  bool lazy_graphs;
+  std::vector < Tag_Database::Tag_Row > rows;  // tags added, until the first push
+  std::unique_ptr < Tag_Database > tags;
+  Callback_Sink sink;
+  std::unique_ptr < Run_Foray > foray;  // labels and numbers this engine's hits
+  bool finished;
+  string error;
+
+  ft_engine() :
+    params(),
+    lazy_graphs(false),
+    rows(),
+    tags(),
+    sink(),
+    foray(),
+    finished(false),
+    error()
+  {
+  };
+
+  // once all tags are added, set up run finding
+
+  void begin() {
+    tags.reset(new Tag_Database(rows));
+    std::vector < Tag_Database::Tag_Row > ().swap(rows);
+    sink.tags = tags.get();
+    foray.reset(new Run_Foray(tags.get(), 0, & sink));
+    foray->set_params(params);
+    foray->set_lazy_graphs(lazy_graphs);
+    foray->begin();
+  };
+};
+
+// run f on e, turning any exception into an error return
+
+template < typename F >
+static int
+guard(ft_engine * e, F f) {
+  try {
+    f();
+    e->error.clear();
+    return 0;
+  } catch (std::exception & ex) {
+    e->error = ex.what();
+  } catch (...) {
+    e->error = "unknown error";
+  }
+  return 1;
+};
+
+extern "C" {
+
+void
+ft_default_params(ft_params * params) {
+  Run_Params p;
+  params->burst_slop_ms = p.burst_slop * 1000.0;
+  params->burst_slop_expansion_ms = p.burst_slop_expansion * 1000.0;
+  params->hits_to_confirm = p.hits_to_confirm_id;
+  params->max_skipped_bursts = p.max_skipped_bursts;
+  params->timestamp_wonkiness = p.timestamp_wonkiness;
+  params->max_candidates = p.max_cands_per_id;
+  params->max_total_candidates = p.max_cands_total;
+  params->lazy_graphs = 0;
+};
+
+ft_engine *
+ft_create(const ft_params * params) {
+  ft_engine * e = new (std::nothrow) ft_engine();
+  if (! e || ! params)
+    return e;
+  e->params.set_burst_slop_ms(params->burst_slop_ms);
+  e->params.set_burst_slop_expansion_ms(params->burst_slop_expansion_ms);
+  e->params.hits_to_confirm_id = params->hits_to_confirm;
+  e->params.max_skipped_bursts = params->max_skipped_bursts;
+  e->params.timestamp_wonkiness = params->timestamp_wonkiness;
+  e->params.max_cands_per_id = params->max_candidates;
+  e->params.max_cands_total = params->max_total_candidates;
+  e->lazy_graphs = params->lazy_graphs != 0;
+  return e;
+};
+
+void
+ft_destroy(ft_engine * e) {
+  delete e;
+};
+
+const char *
+ft_last_error(ft_engine * e) {
+  if (! e)
+    return "No engine: ft_create() ran out of memory";
+  return e->error.c_str();
+};
+
+int
+ft_add_tags(ft_engine * e, size_t n, const char * const * proj, const double * id, const double * freq_MHz, const double * bi) {
+  return guard(e, [&]() {
+      if (e->tags)
+        throw std::runtime_error("Tags must be added before hits are pushed");
+      const string * last_proj = 0;
+      for (size_t i = 0; i < n; ++i) {
+        if (! last_proj || *last_proj != proj[i])
+          last_proj = Known_Tag::intern_proj(proj[i]);
+        Tag_Database::Tag_Row r = {last_proj, (Lotek_Tag_ID) id[i], (float) freq_MHz[i], (float) bi[i]};
+        e->rows.push_back(r);
+      }
+    });
+};
+
+void
+ft_set_callback(ft_engine * e, ft_callback cb, void * user) {
+  e->sink.cb = cb;
+  e->sink.user = user;
+};
+
+int
+ft_push(ft_engine * e, size_t n, const double * ts, const double * id, const int * ant, const double * sig,
+        const double * lat, const double * lon, const int * dtaline, const double * ant_freq, const double * gain) {
+  return guard(e, [&]() {
+      if (e->finished)
+        throw std::runtime_error("Hits can't be pushed after ft_finish()");
+      if (! e->tags)
+        e->begin();
+      for (size_t i = 0; i < n; ++i) {
+        Hit h = Hit::make(e->foray->get_codes(), ts[i], (Lotek_Tag_ID) id[i], ant[i], sig ? sig[i] : 0, lat ? lat[i] : 0, lon ? lon[i] : 0,
+                          dtaline ? dtaline[i] : 0, ant_freq[i], gain ? gain[i] : 0, 0);
+        e->foray->push(h);
+      }
+    });
+};
+
+size_t
+ft_pull(ft_engine * e, ft_run_hit * out, size_t max) {
+  size_t n = 0;
+  while (n < max && ! e->sink.queue.empty()) {
+    out[n++] = e->sink.queue.front();
+    e->sink.queue.pop_front();
+  }
+  return n;
+};
+
+int
+ft_finish(ft_engine * e) {
+  return guard(e, [&]() {
+      if (e->finished)
+        return;
+      if (! e->tags)
+        e->begin();
+      e->finished = true;
+      e->foray->finish();
+    });
+};
+
+}
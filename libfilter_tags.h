@@ -0,0 +1,110 @@
+/*
+  libfilter_tags.h - C interface to the tag filter, for embedding it
+  in other programs (e.g. an R package) without going through files.
+
+  An engine is created with parameters, given its registered tags,
+  then pushed batches of hits in the order they are to be processed.
+  Hits from confirmed runs are handed to a callback as they are found,
+  or, if there is none, queued until taken with ft_pull().  Output is
+  the same as filter_tags would give for the same tags, parameters
+  and hits.
+
+  Each engine has its own tags, graphs, run candidates, run IDs and
+  hit numbering, so several can be used at once, each by one thread
+  at a time.
+  Warnings (e.g. about IDs not in the tag database) go to stderr.
+
+  Functions returning int return 0 on success; otherwise,
+  ft_last_error() says what went wrong.
+*/
+
+#ifndef LIBFILTER_TAGS_H
+#define LIBFILTER_TAGS_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ft_engine ft_engine;
+
+/* parameters of run finding; see the filter_tags options of the same names */
+
+typedef struct {
+  double        burst_slop_ms;            /* -b */
+  double        burst_slop_expansion_ms;  /* -B */
+  unsigned int  hits_to_confirm;          /* -c */
+  unsigned int  max_skipped_bursts;       /* -S */
+  unsigned int  timestamp_wonkiness;      /* -t */
+  unsigned int  max_candidates;           /* -m; 0 means no limit */
+  unsigned int  max_total_candidates;     /* -M; 0 means no limit */
+  int           lazy_graphs;              /* -G, if non-zero */
+} ft_params;
+
+/* a hit from a confirmed run */
+
+typedef struct {
+  long long           hit;         /* position among all hits pushed, from 0 */
+  double              ts;
+  int                 ant;         /* antenna code, as pushed */
+  int                 tag;         /* position among all tags added, from 0 */
+  const char *        tag_id;      /* full ID of the tag, PROJ#ID@FREQ:BI; valid until ft_destroy() */
+  unsigned long long  run_id;      /* from 1, as filter_tags numbers runs */
+  unsigned int        pos_in_run;  /* from 1 */
+  double              burst_slop;  /* as in the burstSlop column of filter_tags output */
+} ft_run_hit;
+
+typedef void (* ft_callback) (void * user, const ft_run_hit * h);
+
+/* fill params with the defaults used by filter_tags */
+
+void ft_default_params (ft_params * params);
+
+/* a new engine; params can be NULL for the defaults.  Returns NULL if
+   out of memory. */
+
+ft_engine * ft_create (const ft_params * params);
+
+void ft_destroy (ft_engine * e);
+
+/* the reason the last call on e failed; if e is NULL (i.e. ft_create()
+   failed), a message saying so */
+
+const char * ft_last_error (ft_engine * e);
+
+/* add n registered tags, as in the columns of a tag database:
+   project, Lotek ID, nominal frequency (MHz), and burst interval (s).
+   A tag database's Lotek IDs can have a fractional part (e.g. 2.1)
+   telling apart tags sharing one ID, so IDs here and in ft_push() are
+   doubles.  Only valid before the first ft_push(). */
+
+int ft_add_tags (ft_engine * e, size_t n, const char * const * proj, const double * id, const double * freq_MHz, const double * bi);
+
+/* hand each hit from a confirmed run to cb, with user, as it is found,
+   rather than queueing it for ft_pull().  cb must not call ft_push()
+   or ft_finish() on e. */
+
+void ft_set_callback (ft_engine * e, ft_callback cb, void * user);
+
+/* process n hits, given as the columns of a TAGHITS.CSV file.  Any of
+   sig, lat, lon, dtaline and gain can be NULL, for all zeroes.  The
+   first push builds graphs for the tags added so far. */
+
+int ft_push (ft_engine * e, size_t n, const double * ts, const double * id, const int * ant, const double * sig,
+             const double * lat, const double * lon, const int * dtaline, const double * ant_freq, const double * gain);
+
+/* take up to max queued hits into out, returning how many were taken */
+
+size_t ft_pull (ft_engine * e, ft_run_hit * out, size_t max);
+
+/* note the end of input.  Runs still open then are not ended, just as
+   with filter_tags; no further hits can be pushed. */
+
+int ft_finish (ft_engine * e);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBFILTER_TAGS_H */
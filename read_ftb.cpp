@@ -0,0 +1,138 @@
+/*
+
+  read_ftb: convert binary output from filter_tags --output-format=binary
+  to the .CSV format filter_tags writes by default.
+
+  Copyright 2013 John Brzustowski
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307 USA
+
+- - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
+*/
+
+#include <stdio.h>
+#include <getopt.h>
+
+#include "filter_tags_common.hpp"
+#include "Binary_Reader.hpp"
+
+void
+usage() {
+  puts (
+	"Usage:\n"
+	"    read_ftb [OPTIONS] [HITS.FTB]\n"
+	"where:\n\n"
+
+	"HITS.FTB is output from filter_tags --output-format=binary; it is\n"
+	"    written to stdout as .CSV, byte-for-byte the same as filter_tags\n"
+	"    would have written with --output-format=csv.\n"
+	"    If unspecified, input is read from stdin\n\n"
+
+	"and OPTIONS can be any of:\n\n"
+
+        "-h  --help\n"
+        "    print this help message\n\n"
+
+	"-n, --no-header\n"
+	"    don't output the column names header.\n\n"
+
+	"-s, --summary\n"
+	"    instead of the hits, print the number of hits, chunks, antenna codes\n"
+	"    and tags in the input.\n\n"
+	);
+}
+
+int
+main (int argc, char **argv) {
+    enum {
+        COMMAND_HELP	         = 'h',
+	OPT_NO_HEADER	         = 'n',
+	OPT_SUMMARY	         = 's',
+    };
+
+    int option_index;
+    static const char short_options[] = "hns";
+    static const struct option long_options[] = {
+        {"help"			   , 0, 0, COMMAND_HELP},
+	{"no-header"		   , 0, 0, OPT_NO_HEADER},
+	{"summary"		   , 0, 0, OPT_SUMMARY},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    bool header_desired = true;
+    bool summary = false;
+
+    while ((c = getopt_long(argc, argv, short_options, long_options, &option_index)) != -1) {
+        switch (c) {
+        case COMMAND_HELP:
+            usage();
+            exit(0);
+	case OPT_NO_HEADER:
+	  header_desired = false;
+	  break;
+	case OPT_SUMMARY:
+	  summary = true;
+	  break;
+        default:
+            usage();
+            exit(1);
+        }
+    }
+
+    string filename = optind < argc ? string(argv[optind]) : "";
+
+    try {
+      Binary_Reader r(filename);
+
+      if (summary) {
+        printf("hits: %lu\nchunks: %lu\nantenna codes: %lu\ntags: %lu\n",
+               (unsigned long) r.rows, (unsigned long) r.chunks.size(),
+               (unsigned long) r.ant_codes.size(), (unsigned long) r.full_ids.size());
+        exit(0);
+      }
+
+      // same header as Run_Candidate::output_header()
+      if (header_desired)
+        puts("\"ts\",\"ant\",\"id\",\"runID\",\"posInRun\",\"sig\",\"burstSlop\",\"DTAline\",\"lat\",\"lon\",\"antFreq\",\"gain\"");
+
+      using namespace Binary_Format;
+
+      for (size_t k = 0; k < r.chunks.size(); ++k) {
+        for (size_t i = 0; i < r.chunks[k].rows; ++i) {
+          uint32_t ant = r.get < uint32_t > (k, ANT, i);
+          uint32_t tag = r.get < uint32_t > (k, TAG, i);
+          if (ant >= r.ant_codes.size() || tag >= r.full_ids.size())
+            throw std::runtime_error("Hit refers to a missing string in binary input");
+          printf("%.14g,%s,%s,%llu,%u,%d,%.4g,%u,%.9g,%.9g,%.6g,%d\n",
+                 r.get < double > (k, TS, i),
+                 r.ant_codes[ant].c_str(),
+                 r.full_ids[tag].c_str(),
+                 (unsigned long long) r.get < uint64_t > (k, RUN_ID, i),
+                 r.get < uint32_t > (k, POS_IN_RUN, i),
+                 r.get < int16_t > (k, SIG, i),
+                 r.get < double > (k, BURST_SLOP, i),
+                 r.get < uint32_t > (k, DTALINE, i),
+                 r.get < float > (k, LAT, i),
+                 r.get < float > (k, LON, i),
+                 r.get < double > (k, ANT_FREQ, i),
+                 r.get < int16_t > (k, GAIN, i));
+        }
+      }
+    } catch (std::runtime_error& e) {
+      std::cerr << e.what();
+      exit(1);
+    }
+}